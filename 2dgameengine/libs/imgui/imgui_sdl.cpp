@@ -8,111 +8,32 @@
 
 #include "imgui.h"
 
-#include <map>
-#include <list>
 #include <cmath>
-#include <array>
 #include <vector>
-#include <memory>
-#include <iostream>
+#include <cstdint>
+#include <cstddef>
 #include <algorithm>
-#include <functional>
-#include <unordered_map>
+
+// SDL 2.0.18 added SDL_RenderGeometryRaw, which lets us hand the ImGui vertex and index buffers to the renderer as they are.
+// Older versions fall back to rasterizing every triangle on the CPU.
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+ #define IMGUI_SDL_HAS_RENDER_GEOMETRY 1
+#else
+ #define IMGUI_SDL_HAS_RENDER_GEOMETRY 0
+#endif
+
+// The software rasterizer shades four pixels at once with SSE2, which every x86-64 CPU has. Other CPUs use the scalar loop.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #define IMGUI_SDL_HAS_SSE2 1
+ #include <emmintrin.h>
+#else
+ #define IMGUI_SDL_HAS_SSE2 0
+#endif
 
 namespace
 {
 	struct Device* CurrentDevice = nullptr;
 
-	namespace TupleHash
-	{
-		template <typename T> struct Hash
-		{
-			std::size_t operator()(const T& value) const
-			{
-				return std::hash<T>()(value);
-			}
-		};
-
-		template <typename T> void CombineHash(std::size_t& seed, const T& value)
-		{
-			seed ^= TupleHash::Hash<T>()(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-		}
-
-		template <typename Tuple, std::size_t Index = std::tuple_size<Tuple>::value - 1> struct Hasher
-		{
-			static void Hash(std::size_t& seed, const Tuple& tuple)
-			{
-				Hasher<Tuple, Index - 1>::Hash(seed, tuple);
-				CombineHash(seed, std::get<Index>(tuple));
-			}
-		};
-
-		template <typename Tuple> struct Hasher<Tuple, 0>
-		{
-			static void Hash(std::size_t& seed, const Tuple& tuple)
-			{
-				CombineHash(seed, std::get<0>(tuple));
-			}
-		};
-
-		template <typename... T> struct Hash<std::tuple<T...>>
-		{
-			std::size_t operator()(const std::tuple<T...>& value) const
-			{
-				std::size_t seed = 0;
-				Hasher<std::tuple<T...>>::Hash(seed, value);
-				return seed;
-			}
-		};
-	}
-
-	template <typename Key, typename Value, std::size_t Size> class LRUCache
-	{
-	public:
-		bool Contains(const Key& key) const
-		{
-			return Container.find(key) != Container.end();
-		}
-
-		const Value& At(const Key& key)
-		{
-			assert(Contains(key));
-
-			const auto location = Container.find(key);
-			Order.splice(Order.begin(), Order, location->second);
-			return location->second->second;
-		}
-
-		void Insert(const Key& key, Value value)
-		{
-			const auto existingLocation = Container.find(key);
-			if (existingLocation != Container.end())
-			{
-				Order.erase(existingLocation->second);
-				Container.erase(existingLocation);
-			}
-
-			Order.push_front(std::make_pair(key, std::move(value)));
-			Container.insert(std::make_pair(key, Order.begin()));
-
-			Clean();
-		}
-	private:
-		void Clean()
-		{
-			while (Container.size() > Size)
-			{
-				auto last = Order.end();
-				last--;
-				Container.erase(last->first);
-				Order.pop_back();
-			}
-		}
-
-		std::list<std::pair<Key, Value>> Order;
-		std::unordered_map<Key, decltype(Order.begin()), TupleHash::Hash<Key>> Container;
-	};
-
 	struct Color
 	{
 		const float R, G, B, A;
@@ -143,38 +64,137 @@ namespace
 		}
 	};
 
+	// The software frame holds premultiplied ARGB8888 pixels (0xAARRGGBB), with the channels handled in the 0..255 range.
+	// Texels and vertex colors are ImU32, which stores straight alpha as 0xAABBGGRR.
+
+	inline uint32_t PackPixel(float r, float g, float b, float a)
+	{
+		const auto channel = [](float value) { return static_cast<uint32_t>(std::min(value, 255.0f) + 0.5f); };
+		return (channel(a) << 24) | (channel(r) << 16) | (channel(g) << 8) | channel(b);
+	}
+
+	// Blends a premultiplied color over a pixel of the frame.
+	inline uint32_t BlendPixel(uint32_t destination, float r, float g, float b, float a)
+	{
+		// Same operations, in the same order, as BlendPixels4, so both paths round alike.
+		const float inverseAlpha = 1.0f - a * (1.0f / 255.0f);
+		return PackPixel(
+			r + ((destination >> 16) & 0xff) * inverseAlpha,
+			g + ((destination >> 8) & 0xff) * inverseAlpha,
+			b + ((destination >> 0) & 0xff) * inverseAlpha,
+			a + ((destination >> 24) & 0xff) * inverseAlpha);
+	}
+
+	inline uint32_t UnpremultiplyPixel(uint32_t pixel)
+	{
+		const uint32_t alpha = pixel >> 24;
+		if (alpha == 0) return 0;
+
+		const float scale = 255.0f / alpha;
+		return PackPixel(((pixel >> 16) & 0xff) * scale, ((pixel >> 8) & 0xff) * scale, ((pixel >> 0) & 0xff) * scale, static_cast<float>(alpha));
+	}
+
+#if IMGUI_SDL_HAS_SSE2
+	// Four pixels with one channel per register.
+	struct Pixels4
+	{
+		__m128 R, G, B, A;
+	};
+
+	template <int Shift> inline __m128 UnpackChannel4(__m128i pixels)
+	{
+		return _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(pixels, Shift), _mm_set1_epi32(0xff)));
+	}
+
+	inline Pixels4 UnpackARGB4(__m128i pixels)
+	{
+		return Pixels4{ UnpackChannel4<16>(pixels), UnpackChannel4<8>(pixels), UnpackChannel4<0>(pixels), UnpackChannel4<24>(pixels) };
+	}
+
+	inline Pixels4 UnpackABGR4(__m128i pixels)
+	{
+		return Pixels4{ UnpackChannel4<0>(pixels), UnpackChannel4<8>(pixels), UnpackChannel4<16>(pixels), UnpackChannel4<24>(pixels) };
+	}
+
+	inline __m128i PackARGB4(const Pixels4& pixels)
+	{
+		// Rounds like PackPixel: clamp, add one half, truncate. _mm_cvtps_epi32 would round half to even instead.
+		const __m128 max = _mm_set1_ps(255.0f);
+		const __m128 half = _mm_set1_ps(0.5f);
+		const __m128i r = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(pixels.R, max), half));
+		const __m128i g = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(pixels.G, max), half));
+		const __m128i b = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(pixels.B, max), half));
+		const __m128i a = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(pixels.A, max), half));
+
+		return _mm_or_si128(_mm_or_si128(_mm_slli_epi32(a, 24), _mm_slli_epi32(r, 16)), _mm_or_si128(_mm_slli_epi32(g, 8), b));
+	}
+
+	inline __m128i BlendPixels4(__m128i destination, const Pixels4& source)
+	{
+		const Pixels4 d = UnpackARGB4(destination);
+		const __m128 inverseAlpha = _mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(source.A, _mm_set1_ps(1.0f / 255.0f)));
+
+		return PackARGB4(Pixels4{
+			_mm_add_ps(source.R, _mm_mul_ps(d.R, inverseAlpha)),
+			_mm_add_ps(source.G, _mm_mul_ps(d.G, inverseAlpha)),
+			_mm_add_ps(source.B, _mm_mul_ps(d.B, inverseAlpha)),
+			_mm_add_ps(source.A, _mm_mul_ps(d.A, inverseAlpha))
+		});
+	}
+
+	inline __m128i UnpremultiplyPixels4(__m128i pixels)
+	{
+		const Pixels4 p = UnpackARGB4(pixels);
+
+		// Fully transparent pixels end up all zero, which masks away the division by zero.
+		const __m128 isTransparent = _mm_cmpeq_ps(p.A, _mm_setzero_ps());
+		const __m128 scale = _mm_andnot_ps(isTransparent, _mm_div_ps(_mm_set1_ps(255.0f), p.A));
+
+		return PackARGB4(Pixels4{ _mm_mul_ps(p.R, scale), _mm_mul_ps(p.G, scale), _mm_mul_ps(p.B, scale), _mm_andnot_ps(isTransparent, p.A) });
+	}
+#endif
+
+	void UnpremultiplyRow(const uint32_t* source, uint32_t* destination, int width)
+	{
+		int x = 0;
+#if IMGUI_SDL_HAS_SSE2
+		for (; x + 4 <= width; x += 4)
+		{
+			const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + x));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + x), UnpremultiplyPixels4(pixels));
+		}
+#endif
+		for (; x < width; x++)
+		{
+			destination[x] = UnpremultiplyPixel(source[x]);
+		}
+	}
+
 	struct Device
 	{
 		SDL_Renderer* Renderer;
 
+		// Cleared if the renderer turns out not to support geometry, in which case the software path is used instead.
+		bool UseRenderGeometry = IMGUI_SDL_HAS_RENDER_GEOMETRY;
+
 		struct ClipRect
 		{
 			int X, Y, Width, Height;
 		} Clip;
 
-		struct TriangleCacheItem
-		{
-			SDL_Texture* Texture = nullptr;
-			int Width = 0, Height = 0;
-
-			~TriangleCacheItem() { if (Texture) SDL_DestroyTexture(Texture); }
-		};
-
-		// You can tweak these to values that you find that work the best.
-		static constexpr std::size_t UniformColorTriangleCacheSize = 512;
-		static constexpr std::size_t GenericTriangleCacheSize = 64;
+		// The software path rasterizes into this frame sized buffer, which is uploaded to a streaming texture and drawn with a single copy.
+		// Blending premultiplied pixels is just a multiply and an add, they are converted back to straight alpha on upload for SDL_BLENDMODE_BLEND.
+		std::vector<uint32_t> FramePixels;
+		int FrameWidth = 0, FrameHeight = 0;
+		// Rows are padded to a multiple of 4 pixels, so the SIMD loop can always load and store whole groups of pixels.
+		int FramePitch = 0;
+		SDL_Texture* FrameTexture = nullptr;
 
-		// Uniform color is identified by its color and the coordinates of the edges.
-		using UniformColorTriangleKey = std::tuple<uint32_t, int, int, int, int, int, int>;
-		// The generic triangle cache unfortunately has to be basically a full representation of the triangle.
-		// This includes the (offset) vertex positions, texture coordinates and vertex colors.
-		using GenericTriangleVertexKey = std::tuple<int, int, double, double, uint32_t>;
-		using GenericTriangleKey = std::tuple<GenericTriangleVertexKey, GenericTriangleVertexKey, GenericTriangleVertexKey>;
-
-		LRUCache<UniformColorTriangleKey, std::unique_ptr<TriangleCacheItem>, UniformColorTriangleCacheSize> UniformColorTriangleCache;
-		LRUCache<GenericTriangleKey, std::unique_ptr<TriangleCacheItem>, GenericTriangleCacheSize> GenericTriangleCache;
+		// What was drawn to since the last upload, only that part of the frame is uploaded and cleared.
+		int DirtyMinX = 0, DirtyMinY = 0, DirtyMaxX = 0, DirtyMaxY = 0;
 
 		Device(SDL_Renderer* renderer) : Renderer(renderer) { }
+		~Device() { if (FrameTexture) SDL_DestroyTexture(FrameTexture); }
 
 		void SetClipRect(const ClipRect& rect)
 		{
@@ -186,27 +206,73 @@ namespace
 		void EnableClip() { SetClipRect(Clip); }
 		void DisableClip() { SDL_RenderSetClipRect(Renderer, nullptr); }
 
-		void SetAt(int x, int y, const Color& color)
+		void ResizeFrame(int width, int height)
+		{
+			width = std::max(width, 0);
+			height = std::max(height, 0);
+			if (width == FrameWidth && height == FrameHeight) return;
+
+			if (FrameTexture) SDL_DestroyTexture(FrameTexture);
+			FrameTexture = nullptr;
+
+			FrameWidth = width;
+			FrameHeight = height;
+			FramePitch = (width + 3) & ~3;
+			FramePixels.assign(static_cast<std::size_t>(FramePitch) * height, 0);
+			ResetDirtyRect();
+
+			if (width > 0 && height > 0)
+			{
+				FrameTexture = SDL_CreateTexture(Renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, width, height);
+				if (FrameTexture) SDL_SetTextureBlendMode(FrameTexture, SDL_BLENDMODE_BLEND);
+			}
+		}
+
+		void ResetDirtyRect()
 		{
-			color.UseAsDrawColor(Renderer);
-			SDL_RenderDrawPoint(Renderer, x, y);
+			DirtyMinX = FrameWidth;
+			DirtyMinY = FrameHeight;
+			DirtyMaxX = 0;
+			DirtyMaxY = 0;
 		}
 
-		SDL_Texture* MakeTexture(int width, int height)
+		void MarkDirty(int minX, int minY, int maxX, int maxY)
 		{
-			SDL_Texture* texture = SDL_CreateTexture(Renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_TARGET, width, height);
-			SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
-			return texture;
+			DirtyMinX = std::min(DirtyMinX, minX);
+			DirtyMinY = std::min(DirtyMinY, minY);
+			DirtyMaxX = std::max(DirtyMaxX, maxX);
+			DirtyMaxY = std::max(DirtyMaxY, maxY);
 		}
 
-		void UseAsRenderTarget(SDL_Texture* texture)
+		// Draws what was rasterized so far over the render target and clears it.
+		void FlushFrame()
 		{
-			SDL_SetRenderTarget(Renderer, texture);
-			if (texture)
+			if (DirtyMinX >= DirtyMaxX || DirtyMinY >= DirtyMaxY) return;
+
+			const SDL_Rect dirty = { DirtyMinX, DirtyMinY, DirtyMaxX - DirtyMinX, DirtyMaxY - DirtyMinY };
+
+			void* texturePixels;
+			int texturePitch;
+			if (FrameTexture && SDL_LockTexture(FrameTexture, &dirty, &texturePixels, &texturePitch) == 0)
+			{
+				for (int y = 0; y < dirty.h; y++)
+				{
+					const uint32_t* source = FramePixels.data() + static_cast<std::size_t>(dirty.y + y) * FramePitch + dirty.x;
+					uint32_t* destination = reinterpret_cast<uint32_t*>(static_cast<uint8_t*>(texturePixels) + static_cast<std::size_t>(y) * texturePitch);
+					UnpremultiplyRow(source, destination, dirty.w);
+				}
+				SDL_UnlockTexture(FrameTexture);
+
+				DisableClip();
+				SDL_RenderCopy(Renderer, FrameTexture, &dirty, &dirty);
+				EnableClip();
+			}
+
+			for (int y = dirty.y; y < dirty.y + dirty.h; y++)
 			{
-				SDL_SetRenderDrawColor(Renderer, 0, 0, 0, 0);
-				SDL_RenderClear(Renderer);
+				std::fill_n(FramePixels.begin() + static_cast<std::ptrdiff_t>(y) * FramePitch + dirty.x, dirty.w, 0u);
 			}
+			ResetDirtyRect();
 		}
 	};
 
@@ -220,44 +286,6 @@ namespace
 			SDL_FreeSurface(Surface);
 			SDL_DestroyTexture(Source);
 		}
-
-		Color Sample(float u, float v) const
-		{
-			const int x = static_cast<int>(std::round(u * (Surface->w - 1) + 0.5f));
-			const int y = static_cast<int>(std::round(v * (Surface->h - 1) + 0.5f));
-
-			const int location = y * Surface->w + x;
-			assert(location < Surface->w * Surface->h);
-
-			return Color(static_cast<uint32_t*>(Surface->pixels)[location]);
-		}
-	};
-
-	template <typename T> class InterpolatedFactorEquation
-	{
-	public:
-		InterpolatedFactorEquation(const T& value0, const T& value1, const T& value2, const ImVec2& v0, const ImVec2& v1, const ImVec2& v2)
-			: Value0(value0), Value1(value1), Value2(value2), V0(v0), V1(v1), V2(v2),
-			Divisor((V1.y - V2.y) * (V0.x - V2.x) + (V2.x - V1.x) * (V0.y - V2.y)) { }
-
-		T Evaluate(float x, float y) const
-		{
-			const float w1 = ((V1.y - V2.y) * (x - V2.x) + (V2.x - V1.x) * (y - V2.y)) / Divisor;
-			const float w2 = ((V2.y - V0.y) * (x - V2.x) + (V0.x - V2.x) * (y - V2.y)) / Divisor;
-			const float w3 = 1.0f - w1 - w2;
-
-			return static_cast<T>((Value0 * w1) + (Value1 * w2) + (Value2 * w3));
-		}
-	private:
-		const T Value0;
-		const T Value1;
-		const T Value2;
-
-		const ImVec2& V0;
-		const ImVec2& V1;
-		const ImVec2& V2;
-
-		const float Divisor;
 	};
 
 	struct Rect
@@ -292,181 +320,296 @@ namespace
 		}
 	};
 
-	struct FixedPointTriangleRenderInfo
+	// What a triangle is filled with: a texel times the vertex color, both interpolated with the barycentric weights of vertices 1 and 2.
+	// Most triangles have a single color and sample only the white pixel of the font, those are filled with one precomputed color.
+	struct TriangleShader
 	{
-		int X1, X2, X3, Y1, Y2, Y3;
-		int MinX, MaxX, MinY, MaxY;
-
-		static FixedPointTriangleRenderInfo CalculateFixedPointTriangleInfo(const ImVec2& v1, const ImVec2& v2, const ImVec2& v3)
-		{
-			static constexpr float scale = 16.0f;
-
-			const int x1 = static_cast<int>(std::round(v1.x * scale));
-			const int x2 = static_cast<int>(std::round(v2.x * scale));
-			const int x3 = static_cast<int>(std::round(v3.x * scale));
-
-			const int y1 = static_cast<int>(std::round(v1.y * scale));
-			const int y2 = static_cast<int>(std::round(v2.y * scale));
-			const int y3 = static_cast<int>(std::round(v3.y * scale));
-
-			int minX = (std::min({ x1, x2, x3 }) + 0xF) >> 4;
-			int maxX = (std::max({ x1, x2, x3 }) + 0xF) >> 4;
-			int minY = (std::min({ y1, y2, y3 }) + 0xF) >> 4;
-			int maxY = (std::max({ y1, y2, y3 }) + 0xF) >> 4;
+		enum Attribute { U, V, ColorR, ColorG, ColorB, ColorA, NumAttributes };
 
-			return FixedPointTriangleRenderInfo{ x1, x2, x3, y1, y2, y3, minX, maxX, minY, maxY };
-		}
-	};
+		bool IsSolid = false;
+		// The premultiplied color of a solid triangle.
+		float R = 0.0f, G = 0.0f, B = 0.0f, A = 0.0f;
 
-	void DrawTriangleWithColorFunction(const FixedPointTriangleRenderInfo& renderInfo, const std::function<Color(float x, float y)>& colorFunction, Device::TriangleCacheItem* cacheItem)
-	{
-		// Implementation source: https://web.archive.org/web/20171128164608/http://forum.devmaster.net/t/advanced-rasterization/6145.
-		// This is a fixed point implementation that rounds to top-left.
+		// The attributes at vertex 0 and their change towards vertices 1 and 2, u and v in texels.
+		float Base[NumAttributes];
+		float Delta1[NumAttributes];
+		float Delta2[NumAttributes];
 
-		const int deltaX12 = renderInfo.X1 - renderInfo.X2;
-		const int deltaX23 = renderInfo.X2 - renderInfo.X3;
-		const int deltaX31 = renderInfo.X3 - renderInfo.X1;
+		// A null texture samples as white.
+		const uint32_t* Texels = nullptr;
+		int TextureWidth = 1, TextureHeight = 1, TexturePitch = 0;
 
-		const int deltaY12 = renderInfo.Y1 - renderInfo.Y2;
-		const int deltaY23 = renderInfo.Y2 - renderInfo.Y3;
-		const int deltaY31 = renderInfo.Y3 - renderInfo.Y1;
+		TriangleShader(const ImDrawVert& v0, const ImDrawVert& v1, const ImDrawVert& v2, const Texture* texture)
+		{
+			if (texture)
+			{
+				Texels = static_cast<const uint32_t*>(texture->Surface->pixels);
+				TextureWidth = texture->Surface->w;
+				TextureHeight = texture->Surface->h;
+				TexturePitch = texture->Surface->pitch / 4;
+			}
 
-		const int fixedDeltaX12 = deltaX12 << 4;
-		const int fixedDeltaX23 = deltaX23 << 4;
-		const int fixedDeltaX31 = deltaX31 << 4;
+			const ImDrawVert* vertices[3] = { &v0, &v1, &v2 };
+			float attributes[3][NumAttributes];
+			for (int i = 0; i < 3; i++)
+			{
+				attributes[i][U] = vertices[i]->uv.x * TextureWidth;
+				attributes[i][V] = vertices[i]->uv.y * TextureHeight;
+				attributes[i][ColorR] = static_cast<float>((vertices[i]->col >> 0) & 0xff);
+				attributes[i][ColorG] = static_cast<float>((vertices[i]->col >> 8) & 0xff);
+				attributes[i][ColorB] = static_cast<float>((vertices[i]->col >> 16) & 0xff);
+				attributes[i][ColorA] = static_cast<float>((vertices[i]->col >> 24) & 0xff);
+			}
+			for (int a = 0; a < NumAttributes; a++)
+			{
+				Base[a] = attributes[0][a];
+				Delta1[a] = attributes[1][a] - attributes[0][a];
+				Delta2[a] = attributes[2][a] - attributes[0][a];
+			}
 
-		const int fixedDeltaY12 = deltaY12 << 4;
-		const int fixedDeltaY23 = deltaY23 << 4;
-		const int fixedDeltaY31 = deltaY31 << 4;
+			IsSolid = v0.col == v1.col && v1.col == v2.col
+				&& v0.uv.x == v1.uv.x && v1.uv.x == v2.uv.x
+				&& v0.uv.y == v1.uv.y && v1.uv.y == v2.uv.y;
+			if (IsSolid)
+			{
+				Shade(0.0f, 0.0f, R, G, B, A);
+			}
+		}
 
-		const int width = renderInfo.MaxX - renderInfo.MinX;
-		const int height = renderInfo.MaxY - renderInfo.MinY;
-		if (width == 0 || height == 0) return;
+		uint32_t Sample(float u, float v) const
+		{
+			if (!Texels) return 0xffffffff;
 
-		int c1 = deltaY12 * renderInfo.X1 - deltaX12 * renderInfo.Y1;
-		int c2 = deltaY23 * renderInfo.X2 - deltaX23 * renderInfo.Y2;
-		int c3 = deltaY31 * renderInfo.X3 - deltaX31 * renderInfo.Y3;
+			const int x = static_cast<int>(std::min(std::max(u, 0.0f), TextureWidth - 1.0f));
+			const int y = static_cast<int>(std::min(std::max(v, 0.0f), TextureHeight - 1.0f));
+			return Texels[y * TexturePitch + x];
+		}
 
-		if (deltaY12 < 0 || (deltaY12 == 0 && deltaX12 > 0)) c1++;
-		if (deltaY23 < 0 || (deltaY23 == 0 && deltaX23 > 0)) c2++;
-		if (deltaY31 < 0 || (deltaY31 == 0 && deltaX31 > 0)) c3++;
+		// Computes the premultiplied color at the given barycentric weights.
+		void Shade(float weight1, float weight2, float& r, float& g, float& b, float& a) const
+		{
+			float values[NumAttributes];
+			for (int i = 0; i < NumAttributes; i++)
+			{
+				// Summed in the same order as Shade4.
+				values[i] = Base[i] + (weight1 * Delta1[i] + weight2 * Delta2[i]);
+			}
 
-		int edgeStart1 = c1 + deltaX12 * (renderInfo.MinY << 4) - deltaY12 * (renderInfo.MinX << 4);
-		int edgeStart2 = c2 + deltaX23 * (renderInfo.MinY << 4) - deltaY23 * (renderInfo.MinX << 4);
-		int edgeStart3 = c3 + deltaX31 * (renderInfo.MinY << 4) - deltaY31 * (renderInfo.MinX << 4);
+			const uint32_t texel = Sample(values[U], values[V]);
+			a = ((texel >> 24) & 0xff) * values[ColorA] * (1.0f / 255.0f);
 
-		SDL_Texture* cache = CurrentDevice->MakeTexture(width, height);
-		CurrentDevice->DisableClip();
-		CurrentDevice->UseAsRenderTarget(cache);
+			const float scale = a * (1.0f / (255.0f * 255.0f));
+			r = ((texel >> 0) & 0xff) * values[ColorR] * scale;
+			g = ((texel >> 8) & 0xff) * values[ColorG] * scale;
+			b = ((texel >> 16) & 0xff) * values[ColorB] * scale;
+		}
 
-		for (int y = renderInfo.MinY; y < renderInfo.MaxY; y++)
+#if IMGUI_SDL_HAS_SSE2
+		Pixels4 Shade4(__m128 weight1, __m128 weight2) const
 		{
-			int edge1 = edgeStart1;
-			int edge2 = edgeStart2;
-			int edge3 = edgeStart3;
-
-			for (int x = renderInfo.MinX; x < renderInfo.MaxX; x++)
+			__m128 values[NumAttributes];
+			for (int i = 0; i < NumAttributes; i++)
 			{
-				if (edge1 > 0 && edge2 > 0 && edge3 > 0)
-				{
-					CurrentDevice->SetAt(x - renderInfo.MinX, y - renderInfo.MinY, colorFunction(x + 0.5f, y + 0.5f));
-				}
-
-				edge1 -= fixedDeltaY12;
-				edge2 -= fixedDeltaY23;
-				edge3 -= fixedDeltaY31;
+				values[i] = _mm_add_ps(_mm_set1_ps(Base[i]), _mm_add_ps(_mm_mul_ps(weight1, _mm_set1_ps(Delta1[i])), _mm_mul_ps(weight2, _mm_set1_ps(Delta2[i]))));
 			}
 
-			edgeStart1 += fixedDeltaX12;
-			edgeStart2 += fixedDeltaX23;
-			edgeStart3 += fixedDeltaX31;
-		}
+			__m128i texels = _mm_set1_epi32(-1);
+			if (Texels)
+			{
+				// SSE2 has neither a gather nor a 32 bit multiply, so the texel indices are computed in floats and the texels fetched one by one.
+				const __m128 zero = _mm_setzero_ps();
+				const __m128 x = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(values[U], zero), _mm_set1_ps(TextureWidth - 1.0f))));
+				const __m128 y = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(values[V], zero), _mm_set1_ps(TextureHeight - 1.0f))));
+
+				alignas(16) int32_t indices[4];
+				_mm_store_si128(reinterpret_cast<__m128i*>(indices), _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(y, _mm_set1_ps(static_cast<float>(TexturePitch))), x)));
+				texels = _mm_setr_epi32(
+					static_cast<int>(Texels[indices[0]]), static_cast<int>(Texels[indices[1]]),
+					static_cast<int>(Texels[indices[2]]), static_cast<int>(Texels[indices[3]]));
+			}
 
-		CurrentDevice->UseAsRenderTarget(nullptr);
-		CurrentDevice->EnableClip();
+			const Pixels4 texel = UnpackABGR4(texels);
+			const __m128 a = _mm_mul_ps(_mm_mul_ps(texel.A, values[ColorA]), _mm_set1_ps(1.0f / 255.0f));
+			const __m128 scale = _mm_mul_ps(a, _mm_set1_ps(1.0f / (255.0f * 255.0f)));
 
-		cacheItem->Texture = cache;
-		cacheItem->Width = width;
-		cacheItem->Height = height;
-	}
+			return Pixels4{
+				_mm_mul_ps(_mm_mul_ps(texel.R, values[ColorR]), scale),
+				_mm_mul_ps(_mm_mul_ps(texel.G, values[ColorG]), scale),
+				_mm_mul_ps(_mm_mul_ps(texel.B, values[ColorB]), scale),
+				a
+			};
+		}
+#endif
+	};
 
-	void DrawCachedTriangle(const Device::TriangleCacheItem& triangle, const FixedPointTriangleRenderInfo& renderInfo)
+	void RasterizeTriangle(const ImDrawVert& v0, const ImDrawVert& v1, const ImDrawVert& v2, const Texture* texture, const Device::ClipRect& clip)
 	{
-		const SDL_Rect destination = { renderInfo.MinX, renderInfo.MinY, triangle.Width, triangle.Height };
-		SDL_RenderCopy(CurrentDevice->Renderer, triangle.Texture, nullptr, &destination);
-	}
+		// Implementation source: https://web.archive.org/web/20171128164608/http://forum.devmaster.net/t/advanced-rasterization/6145.
+		// The edge functions are in 28.4 fixed point and evaluated at the pixel centers, with a top-left fill rule
+		// so that the pixels on an edge shared by two triangles are blended only once.
 
-	void DrawTriangle(const ImDrawVert& v1, const ImDrawVert& v2, const ImDrawVert& v3, const Texture* texture)
-	{
-		// The naming inconsistency in the parameters is intentional. The fixed point algorithm wants the vertices in a counter clockwise order.
-		const auto& renderInfo = FixedPointTriangleRenderInfo::CalculateFixedPointTriangleInfo(v3.pos, v2.pos, v1.pos);
+		const ImDrawVert* vertices[3] = { &v0, &v1, &v2 };
+		int64_t x[3], y[3];
+		for (int i = 0; i < 3; i++)
+		{
+			// Clamped only to keep the conversion defined, nothing that far away is visible.
+			static constexpr float limit = 1 << 24;
+			x[i] = static_cast<int64_t>(std::round(std::min(std::max(vertices[i]->pos.x, -limit), limit) * 16.0f));
+			y[i] = static_cast<int64_t>(std::round(std::min(std::max(vertices[i]->pos.y, -limit), limit) * 16.0f));
+		}
+
+		// ImGui doesn't guarantee the winding, so the triangle is flipped to make the edge functions positive inside.
+		int64_t area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+		if (area == 0) return;
+		if (area < 0)
+		{
+			std::swap(x[1], x[2]);
+			std::swap(y[1], y[2]);
+			std::swap(vertices[1], vertices[2]);
+			area = -area;
+		}
 
-		// First we check if there is a cached version of this triangle already waiting for us. If so, we can just do a super fast texture copy.
+		// The pixels whose center lies in the bounding box, clipped. Pixel centers are at 16 * n + 8 in fixed point.
+		const int64_t minX = std::max<int64_t>({ (std::min({ x[0], x[1], x[2] }) - 8 + 15) >> 4, clip.X, 0 });
+		const int64_t minY = std::max<int64_t>({ (std::min({ y[0], y[1], y[2] }) - 8 + 15) >> 4, clip.Y, 0 });
+		const int64_t maxX = std::min<int64_t>({ ((std::max({ x[0], x[1], x[2] }) - 8) >> 4) + 1, static_cast<int64_t>(clip.X) + clip.Width, CurrentDevice->FrameWidth });
+		const int64_t maxY = std::min<int64_t>({ ((std::max({ y[0], y[1], y[2] }) - 8) >> 4) + 1, static_cast<int64_t>(clip.Y) + clip.Height, CurrentDevice->FrameHeight });
+		if (minX >= maxX || minY >= maxY) return;
 
-		const auto key = std::make_tuple(
-			std::make_tuple(static_cast<int>(std::round(v1.pos.x)) - renderInfo.MinX, static_cast<int>(std::round(v1.pos.y)) - renderInfo.MinY, v1.uv.x, v1.uv.y, v1.col),
-			std::make_tuple(static_cast<int>(std::round(v2.pos.x)) - renderInfo.MinX, static_cast<int>(std::round(v2.pos.y)) - renderInfo.MinY, v2.uv.x, v2.uv.y, v2.col),
-			std::make_tuple(static_cast<int>(std::round(v3.pos.x)) - renderInfo.MinX, static_cast<int>(std::round(v3.pos.y)) - renderInfo.MinY, v3.uv.x, v3.uv.y, v3.col));
+		const int startX = static_cast<int>(minX), startY = static_cast<int>(minY);
+		const int endX = static_cast<int>(maxX), endY = static_cast<int>(maxY);
+		CurrentDevice->MarkDirty(startX, startY, endX, endY);
 
-		if (CurrentDevice->GenericTriangleCache.Contains(key))
+		// Edge i is opposite of vertex i, its value at the first pixel center and how it changes per pixel.
+		int64_t edges[3], stepsX[3], stepsY[3];
+		for (int i = 0; i < 3; i++)
 		{
-			const auto& cached = CurrentDevice->GenericTriangleCache.At(key);
-			DrawCachedTriangle(*cached, renderInfo);
+			const int a = (i + 1) % 3;
+			const int b = (i + 2) % 3;
+			const int64_t deltaX = x[b] - x[a];
+			const int64_t deltaY = y[b] - y[a];
 
-			return;
+			edges[i] = deltaX * (minY * 16 + 8 - y[a]) - deltaY * (minX * 16 + 8 - x[a]);
+			stepsX[i] = -deltaY * 16;
+			stepsY[i] = deltaX * 16;
+
+			// Pixel centers exactly on a top or left edge are inside, so those edges get to test for >= 0 instead of > 0.
+			if (deltaY < 0 || (deltaY == 0 && deltaX > 0)) edges[i]++;
 		}
 
-		const InterpolatedFactorEquation<float> textureU(v1.uv.x, v2.uv.x, v3.uv.x, v1.pos, v2.pos, v3.pos);
-		const InterpolatedFactorEquation<float> textureV(v1.uv.y, v2.uv.y, v3.uv.y, v1.pos, v2.pos, v3.pos);
+		const TriangleShader shader(*vertices[0], *vertices[1], *vertices[2], texture);
+		const float inverseArea = 1.0f / static_cast<float>(area);
 
-		const InterpolatedFactorEquation<Color> shadeColor(Color(v1.col), Color(v2.col), Color(v3.col), v1.pos, v2.pos, v3.pos);
+		uint32_t* frame = CurrentDevice->FramePixels.data();
+		const int pitch = CurrentDevice->FramePitch;
 
-		auto cached = std::make_unique<Device::TriangleCacheItem>();
-		DrawTriangleWithColorFunction(renderInfo, [&](float x, float y) {
-			const float u = textureU.Evaluate(x, y);
-			const float v = textureV.Evaluate(x, y);
-			const Color sampled = texture->Sample(u, v);
-			const Color shade = shadeColor.Evaluate(x, y);
+#if IMGUI_SDL_HAS_SSE2
+		// The SIMD loop works on groups of 4 pixels aligned in the padded rows, with 32 bit edge values.
+		// The edge functions are linear, so they stay in range over the whole box if they are at its corners.
+		const int alignedStartX = startX & ~3;
+		const int alignedEndX = (endX + 3) & ~3;
 
-			return sampled * shade;
-		}, cached.get());
+		bool fitsInt32 = true;
+		for (int i = 0; i < 3; i++)
+		{
+			const auto fits = [](int64_t value) { return value >= INT32_MIN && value <= INT32_MAX; };
+			fitsInt32 = fitsInt32 && fits(stepsX[i] * 4) && fits(stepsY[i]);
+			for (int cornerY : { startY, endY })
+			{
+				for (int cornerX : { alignedStartX, alignedEndX })
+				{
+					fitsInt32 = fitsInt32 && fits(edges[i] + stepsX[i] * (cornerX - startX) + stepsY[i] * (cornerY - startY));
+				}
+			}
+		}
 
-		if (!cached->Texture) return;
+		if (fitsInt32)
+		{
+			__m128i rowEdges[3], stepsX4[3], stepsY4[3];
+			for (int i = 0; i < 3; i++)
+			{
+				const int32_t edge = static_cast<int32_t>(edges[i] + stepsX[i] * (alignedStartX - startX));
+				const int32_t step = static_cast<int32_t>(stepsX[i]);
+				rowEdges[i] = _mm_setr_epi32(edge, edge + step, edge + 2 * step, edge + 3 * step);
+				stepsX4[i] = _mm_set1_epi32(step * 4);
+				stepsY4[i] = _mm_set1_epi32(static_cast<int32_t>(stepsY[i]));
+			}
 
-		const SDL_Rect destination = { renderInfo.MinX, renderInfo.MinY, cached->Width, cached->Height };
-		SDL_RenderCopy(CurrentDevice->Renderer, cached->Texture, nullptr, &destination);
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i laneOffsets = _mm_setr_epi32(0, 1, 2, 3);
+			const __m128i four = _mm_set1_epi32(4);
+			const __m128i firstX = _mm_set1_epi32(startX - 1);
+			const __m128i lastX = _mm_set1_epi32(endX);
+			const __m128 inverseArea4 = _mm_set1_ps(inverseArea);
+			const Pixels4 solid = { _mm_set1_ps(shader.R), _mm_set1_ps(shader.G), _mm_set1_ps(shader.B), _mm_set1_ps(shader.A) };
 
-		CurrentDevice->GenericTriangleCache.Insert(key, std::move(cached));
-	}
+			for (int py = startY; py < endY; py++)
+			{
+				uint32_t* row = frame + static_cast<std::size_t>(py) * pitch;
+				__m128i edge0 = rowEdges[0], edge1 = rowEdges[1], edge2 = rowEdges[2];
+				__m128i laneX = _mm_add_epi32(_mm_set1_epi32(alignedStartX), laneOffsets);
 
-	void DrawUniformColorTriangle(const ImDrawVert& v1, const ImDrawVert& v2, const ImDrawVert& v3)
-	{
-		const Color color(v1.col);
+				for (int px = alignedStartX; px < endX; px += 4)
+				{
+					__m128i covered = _mm_and_si128(_mm_cmpgt_epi32(edge0, zero), _mm_cmpgt_epi32(edge1, zero));
+					covered = _mm_and_si128(covered, _mm_cmpgt_epi32(edge2, zero));
+					covered = _mm_and_si128(covered, _mm_and_si128(_mm_cmpgt_epi32(laneX, firstX), _mm_cmplt_epi32(laneX, lastX)));
+
+					if (_mm_movemask_epi8(covered) != 0)
+					{
+						const Pixels4 source = shader.IsSolid
+							? solid
+							: shader.Shade4(_mm_mul_ps(_mm_cvtepi32_ps(edge1), inverseArea4), _mm_mul_ps(_mm_cvtepi32_ps(edge2), inverseArea4));
+
+						__m128i* pixels = reinterpret_cast<__m128i*>(row + px);
+						const __m128i destination = _mm_loadu_si128(pixels);
+						const __m128i blended = BlendPixels4(destination, source);
+						_mm_storeu_si128(pixels, _mm_or_si128(_mm_and_si128(covered, blended), _mm_andnot_si128(covered, destination)));
+					}
 
-		// The naming inconsistency in the parameters is intentional. The fixed point algorithm wants the vertices in a counter clockwise order.
-		const auto& renderInfo = FixedPointTriangleRenderInfo::CalculateFixedPointTriangleInfo(v3.pos, v2.pos, v1.pos);
+					edge0 = _mm_add_epi32(edge0, stepsX4[0]);
+					edge1 = _mm_add_epi32(edge1, stepsX4[1]);
+					edge2 = _mm_add_epi32(edge2, stepsX4[2]);
+					laneX = _mm_add_epi32(laneX, four);
+				}
 
-		const auto key =std::make_tuple(v1.col,
-			static_cast<int>(std::round(v1.pos.x)) - renderInfo.MinX, static_cast<int>(std::round(v1.pos.y)) - renderInfo.MinY,
-			static_cast<int>(std::round(v2.pos.x)) - renderInfo.MinX, static_cast<int>(std::round(v2.pos.y)) - renderInfo.MinY,
-			static_cast<int>(std::round(v3.pos.x)) - renderInfo.MinX, static_cast<int>(std::round(v3.pos.y)) - renderInfo.MinY);
-		if (CurrentDevice->UniformColorTriangleCache.Contains(key))
-		{
-			const auto& cached = CurrentDevice->UniformColorTriangleCache.At(key);
-			DrawCachedTriangle(*cached, renderInfo);
+				for (int i = 0; i < 3; i++)
+				{
+					rowEdges[i] = _mm_add_epi32(rowEdges[i], stepsY4[i]);
+				}
+			}
 
 			return;
 		}
+#endif
 
-		auto cached = std::make_unique<Device::TriangleCacheItem>();
-		DrawTriangleWithColorFunction(renderInfo, [&color](float, float) { return color; }, cached.get());
+		for (int py = startY; py < endY; py++)
+		{
+			uint32_t* row = frame + static_cast<std::size_t>(py) * pitch;
+			int64_t edge0 = edges[0], edge1 = edges[1], edge2 = edges[2];
 
-		if (!cached->Texture) return;
+			for (int px = startX; px < endX; px++)
+			{
+				if (edge0 > 0 && edge1 > 0 && edge2 > 0)
+				{
+					float r = shader.R, g = shader.G, b = shader.B, a = shader.A;
+					if (!shader.IsSolid)
+					{
+						shader.Shade(edge1 * inverseArea, edge2 * inverseArea, r, g, b, a);
+					}
+					row[px] = BlendPixel(row[px], r, g, b, a);
+				}
 
-		const SDL_Rect destination = { renderInfo.MinX, renderInfo.MinY, cached->Width, cached->Height };
-		SDL_RenderCopy(CurrentDevice->Renderer, cached->Texture, nullptr, &destination);
+				edge0 += stepsX[0];
+				edge1 += stepsX[1];
+				edge2 += stepsX[2];
+			}
 
-		CurrentDevice->UniformColorTriangleCache.Insert(key, std::move(cached));
+			for (int i = 0; i < 3; i++)
+			{
+				edges[i] += stepsY[i];
+			}
+		}
 	}
 
 	void DrawRectangle(const Rect& bounding, SDL_Texture* texture, int textureWidth, int textureHeight, const Color& color, bool doHorizontalFlip, bool doVerticalFlip)
@@ -504,17 +647,48 @@ namespace
 		}
 	}
 
-	void DrawRectangle(const Rect& bounding, const Texture* texture, const Color& color, bool doHorizontalFlip, bool doVerticalFlip)
-	{
-		DrawRectangle(bounding, texture->Source, texture->Surface->w, texture->Surface->h, color, doHorizontalFlip, doVerticalFlip);
-	}
-
 	void DrawRectangle(const Rect& bounding, SDL_Texture* texture, const Color& color, bool doHorizontalFlip, bool doVerticalFlip)
 	{
 		int width, height;
 		SDL_QueryTexture(texture, nullptr, nullptr, &width, &height);
 		DrawRectangle(bounding, texture, width, height, color, doHorizontalFlip, doVerticalFlip);
 	}
+
+#if IMGUI_SDL_HAS_RENDER_GEOMETRY
+	// Submits all the triangles of a draw command, which share a texture and a clip rect, in a single call.
+	// Returns false if the renderer can't draw geometry.
+	bool DrawCommandGeometry(const ImDrawList* commandList, const ImDrawCmd* drawCommand)
+	{
+		ImGuiIO& io = ImGui::GetIO();
+
+		// The font texture is wrapped with the surface used by the software path, any other texture is an SDL texture.
+		SDL_Texture* texture = drawCommand->TextureId == io.Fonts->TexID
+			? static_cast<const Texture*>(drawCommand->TextureId)->Source
+			: static_cast<SDL_Texture*>(drawCommand->TextureId);
+
+		// The vertices are passed in place: ImDrawVert interleaves the position, the texture coordinates and the color.
+		const ImDrawVert* vertices = commandList->VtxBuffer.Data + drawCommand->VtxOffset;
+		const int numVertices = commandList->VtxBuffer.Size - static_cast<int>(drawCommand->VtxOffset);
+		const ImDrawIdx* indices = commandList->IdxBuffer.Data + drawCommand->IdxOffset;
+
+		const float* positions = reinterpret_cast<const float*>(reinterpret_cast<const char*>(vertices) + offsetof(ImDrawVert, pos));
+		const float* uvs = reinterpret_cast<const float*>(reinterpret_cast<const char*>(vertices) + offsetof(ImDrawVert, uv));
+
+		// ImU32 colors are stored as R, G, B, A bytes, the same layout as SDL_Color.
+#if SDL_VERSION_ATLEAST(2, 0, 19)
+		const SDL_Color* colors = reinterpret_cast<const SDL_Color*>(reinterpret_cast<const char*>(vertices) + offsetof(ImDrawVert, col));
+#else
+		const int* colors = reinterpret_cast<const int*>(reinterpret_cast<const char*>(vertices) + offsetof(ImDrawVert, col));
+#endif
+
+		return SDL_RenderGeometryRaw(CurrentDevice->Renderer, texture,
+			positions, sizeof(ImDrawVert),
+			colors, sizeof(ImDrawVert),
+			uvs, sizeof(ImDrawVert),
+			numVertices,
+			indices, static_cast<int>(drawCommand->ElemCount), sizeof(ImDrawIdx)) == 0;
+	}
+#endif
 }
 
 namespace ImGuiSDL
@@ -554,6 +728,18 @@ namespace ImGuiSDL
 		delete CurrentDevice;
 	}
 
+	std::size_t GetTextureMemoryUsage()
+	{
+		std::size_t bytes = 0;
+
+		const Texture* fontTexture = static_cast<const Texture*>(ImGui::GetIO().Fonts->TexID);
+		if (fontTexture && fontTexture->Surface) bytes += static_cast<std::size_t>(fontTexture->Surface->w) * fontTexture->Surface->h * 4;
+
+		if (CurrentDevice && CurrentDevice->FrameTexture) bytes += static_cast<std::size_t>(CurrentDevice->FrameWidth) * CurrentDevice->FrameHeight * 4;
+
+		return bytes;
+	}
+
 	void Render(ImDrawData* drawData)
 	{
 		SDL_BlendMode blendMode;
@@ -574,7 +760,7 @@ namespace ImGuiSDL
 		for (int n = 0; n < drawData->CmdListsCount; n++)
 		{
 			auto commandList = drawData->CmdLists[n];
-			auto vertexBuffer = commandList->VtxBuffer;
+			const auto& vertexBuffer = commandList->VtxBuffer;
 			auto indexBuffer = commandList->IdxBuffer.Data;
 
 			for (int cmd_i = 0; cmd_i < commandList->CmdBuffer.Size; cmd_i++)
@@ -593,32 +779,48 @@ namespace ImGuiSDL
 				{
 					drawCommand->UserCallback(commandList, drawCommand);
 				}
+#if IMGUI_SDL_HAS_RENDER_GEOMETRY
+				else if (CurrentDevice->UseRenderGeometry && DrawCommandGeometry(commandList, drawCommand))
+				{
+					// Drawn in one go by the renderer.
+				}
+#endif
 				else
 				{
-					const bool isWrappedTexture = drawCommand->TextureId == io.Fonts->TexID;
+#if IMGUI_SDL_HAS_RENDER_GEOMETRY
+					// Only reached if the renderer failed to draw geometry, so stop trying.
+					CurrentDevice->UseRenderGeometry = false;
+#endif
+					CurrentDevice->ResizeFrame(static_cast<int>(io.DisplaySize.x), static_cast<int>(io.DisplaySize.y));
 
-					// Loops over triangles.
-					for (unsigned int i = 0; i + 3 <= drawCommand->ElemCount; i += 3)
+					if (drawCommand->TextureId == io.Fonts->TexID || drawCommand->TextureId == nullptr)
 					{
-						const ImDrawVert& v0 = vertexBuffer[indexBuffer[i + 0]];
-						const ImDrawVert& v1 = vertexBuffer[indexBuffer[i + 1]];
-						const ImDrawVert& v2 = vertexBuffer[indexBuffer[i + 2]];
-
-						const Rect& bounding = Rect::CalculateBoundingBox(v0, v1, v2);
-
-						const bool isTriangleUniformColor = v0.col == v1.col && v1.col == v2.col;
-						const bool doesTriangleUseOnlyColor = bounding.UsesOnlyColor();
+						// Rasterized into the frame, which is drawn once at the end.
+						const Texture* texture = static_cast<const Texture*>(drawCommand->TextureId);
+						for (unsigned int i = 0; i + 3 <= drawCommand->ElemCount; i += 3)
+						{
+							RasterizeTriangle(vertexBuffer[indexBuffer[i + 0]], vertexBuffer[indexBuffer[i + 1]], vertexBuffer[indexBuffer[i + 2]], texture, clipRect);
+						}
+					}
+					else
+					{
+						// The rasterizer can only read the font texture, so other textures are drawn by SDL as rectangles.
+						// What was rasterized so far is drawn first to keep the order.
+						CurrentDevice->FlushFrame();
 
-						// Actually, since we render a whole bunch of rectangles, we try to first detect those, and render them more efficiently.
-						// How are rectangles detected? It's actually pretty simple: If all 6 vertices lie on the extremes of the bounding box,
-						// it's a rectangle.
-						if (i + 6 <= drawCommand->ElemCount)
+						// Loops over rectangles: if all 6 vertices of two triangles lie on the extremes of their bounding box, it's a rectangle.
+						for (unsigned int i = 0; i + 6 <= drawCommand->ElemCount; i += 6)
 						{
+							const ImDrawVert& v0 = vertexBuffer[indexBuffer[i + 0]];
+							const ImDrawVert& v1 = vertexBuffer[indexBuffer[i + 1]];
+							const ImDrawVert& v2 = vertexBuffer[indexBuffer[i + 2]];
 							const ImDrawVert& v3 = vertexBuffer[indexBuffer[i + 3]];
 							const ImDrawVert& v4 = vertexBuffer[indexBuffer[i + 4]];
 							const ImDrawVert& v5 = vertexBuffer[indexBuffer[i + 5]];
 
-							const bool isUniformColor = isTriangleUniformColor && v2.col == v3.col && v3.col == v4.col && v4.col == v5.col;
+							const Rect& bounding = Rect::CalculateBoundingBox(v0, v1, v2);
+
+							const bool isUniformColor = v0.col == v1.col && v1.col == v2.col && v2.col == v3.col && v3.col == v4.col && v4.col == v5.col;
 
 							if (isUniformColor
 							&& bounding.IsOnExtreme(v0.pos)
@@ -635,30 +837,9 @@ namespace ImGuiSDL
 								const bool doHorizontalFlip = v2.uv.x < v0.uv.x;
 								const bool doVerticalFlip = v2.uv.x < v0.uv.x;
 
-								if (isWrappedTexture)
-								{
-									DrawRectangle(bounding, static_cast<const Texture*>(drawCommand->TextureId), Color(v0.col), doHorizontalFlip, doVerticalFlip);
-								}
-								else
-								{
-									DrawRectangle(bounding, static_cast<SDL_Texture*>(drawCommand->TextureId), Color(v0.col), doHorizontalFlip, doVerticalFlip);
-								}
-
-								i += 3;  // Additional increment to account for the extra 3 vertices we consumed.
-								continue;
+								DrawRectangle(bounding, static_cast<SDL_Texture*>(drawCommand->TextureId), Color(v0.col), doHorizontalFlip, doVerticalFlip);
 							}
 						}
-
-						if (isTriangleUniformColor && doesTriangleUseOnlyColor)
-						{
-							DrawUniformColorTriangle(v0, v1, v2);
-						}
-						else
-						{
-							// Currently we assume that any non rectangular texture samples the font texture. Dunno if that's what actually happens, but it seems to work.
-							assert(isWrappedTexture);
-							DrawTriangle(v0, v1, v2, static_cast<const Texture*>(drawCommand->TextureId));
-						}
 					}
 				}
 
@@ -666,6 +847,7 @@ namespace ImGuiSDL
 			}
 		}
 
+		CurrentDevice->FlushFrame();
 		CurrentDevice->DisableClip();
 
 		SDL_SetRenderTarget(CurrentDevice->Renderer, initialRenderTarget);
@@ -1,6 +1,8 @@
 ﻿#ifndef IMGUI_SDL_H
 #define IMGUI_SDL_H
 
+#include <cstddef>
+
 struct ImDrawData;
 struct SDL_Renderer;
 
@@ -15,6 +17,10 @@ namespace ImGuiSDL {
 	// Call this every frame after ImGui::Render with ImGui::GetDrawData(). This will use the SDL_Renderer provided to the interfrace with Initialize
 	// to draw the contents of the draw data to the screen.
 	void Render(ImDrawData* drawData);
+
+	// Returns the bytes held by the textures the renderer created: the font texture, plus the streaming frame texture once
+	// the software fallback has allocated it.
+	std::size_t GetTextureMemoryUsage();
 }
 
 #endif
\ No newline at end of file
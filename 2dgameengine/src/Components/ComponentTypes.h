@@ -0,0 +1,54 @@
+#ifndef COMPONENTTYPES_H
+#define COMPONENTTYPES_H
+
+#include "../ECS/ComponentLayout.h"
+#include "../ECS/TypeList.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// ComponentTypes
+////////////////////////////////////////////////////////////////////////////////
+// Every component type of the game is listed here, and its position in the
+// list is its component id. Ids are known at compile time, so they are the
+// same on every run and on every thread. Always append new components at the
+// end, so the ids (and anything laid out by them) stay stable. Tags (empty
+// structs deriving from TagComponent) are listed here too: they get an id but
+// no storage.
+////////////////////////////////////////////////////////////////////////////////
+struct TransformComponent;
+struct RigidBodyComponent;
+struct HierarchyComponent;
+struct SpriteComponent;
+struct InterpolationComponent;
+struct EnemyTag;
+struct StaticTag;
+
+// Components with their own memory layout declare it here and define it next to
+// the component. A file that reaches their pools without including the component
+// header then fails to compile, instead of silently using the default layout.
+#ifndef TRANSFORM_LAYOUT_AOS
+template <> struct ComponentLayout<TransformComponent>;
+#endif
+
+using ComponentTypes = TypeList<
+    TransformComponent,
+    RigidBodyComponent,
+    HierarchyComponent,
+    SpriteComponent,
+    InterpolationComponent,
+    EnemyTag,
+    StaticTag
+>;
+
+// Names shown by the debugging tools, in the same order as the list above
+constexpr const char* COMPONENT_NAMES[] = {
+    "Transform",
+    "RigidBody",
+    "Hierarchy",
+    "Sprite",
+    "Interpolation",
+    "Enemy",
+    "Static"
+};
+static_assert(sizeof(COMPONENT_NAMES) / sizeof(COMPONENT_NAMES[0]) == ComponentTypes::size, "Every component type needs a name");
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef HIERARCHYCOMPONENT_H
+#define HIERARCHYCOMPONENT_H
+
+#include <glm/glm.hpp>
+#include "../ECS/ECS.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// HierarchyComponent
+////////////////////////////////////////////////////////////////////////////////
+// Attaches an entity to a parent entity (e.g. a turret to a tank). The local
+// transform is relative to the parent, and the HierarchySystem keeps the
+// TransformComponent of the entity up to date as its world transform. To move
+// a child, change its local transform and call MarkChanged<HierarchyComponent>().
+////////////////////////////////////////////////////////////////////////////////
+struct HierarchyComponent {
+    Entity parent;
+    glm::vec2 localPosition;
+    glm::vec2 localScale;
+    float localRotation;
+
+    HierarchyComponent(Entity parent, glm::vec2 localPosition = glm::vec2(0, 0), glm::vec2 localScale = glm::vec2(1, 1), float localRotation = 0.0): parent(parent) {
+        this->localPosition = localPosition;
+        this->localScale = localScale;
+        this->localRotation = localRotation;
+    }
+};
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef INTERPOLATIONCOMPONENT_H
+#define INTERPOLATIONCOMPONENT_H
+
+#include <glm/glm.hpp>
+
+// The transform of the entity at the start of the last simulation step, used to
+// render it smoothly in between two steps
+struct InterpolationComponent {
+    glm::vec2 previousPosition;
+    float previousRotation;
+
+    InterpolationComponent(glm::vec2 previousPosition = glm::vec2(0, 0), float previousRotation = 0.0) {
+        this->previousPosition = previousPosition;
+        this->previousRotation = previousRotation;
+    }
+};
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef SPRITECOMPONENT_H
+#define SPRITECOMPONENT_H
+
+////////////////////////////////////////////////////////////////////////////////
+// SpriteComponent
+////////////////////////////////////////////////////////////////////////////////
+// The size of the solid rectangle the RenderSystem draws for the entity,
+// before the transform scale is applied. The game has no textures loaded
+// yet, so a sprite is only its width and height.
+////////////////////////////////////////////////////////////////////////////////
+struct SpriteComponent {
+    int width;
+    int height;
+
+    SpriteComponent(int width = 0, int height = 0) {
+        this->width = width;
+        this->height = height;
+    }
+};
+
+#endif
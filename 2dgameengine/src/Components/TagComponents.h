@@ -0,0 +1,12 @@
+#ifndef TAGCOMPONENTS_H
+#define TAGCOMPONENTS_H
+
+#include "../ECS/ComponentLayout.h"
+
+// Marks the entities that fight against the player
+struct EnemyTag: TagComponent {};
+
+// Marks the entities that never move, e.g. buildings and scenery
+struct StaticTag: TagComponent {};
+
+#endif
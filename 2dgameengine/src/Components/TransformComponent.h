@@ -2,11 +2,183 @@
 #define TRANSFORMCOMPONENT_H
 
 #include <glm/glm.hpp>
+#include <utility>
+#include <vector>
+#include "../ECS/ComponentLayout.h"
 
 struct TransformComponent {
     glm::vec2 position;
     glm::vec2 scale;
-    double rotation;
+    float rotation;
+
+    TransformComponent(glm::vec2 position = glm::vec2(0, 0), glm::vec2 scale = glm::vec2(1, 1), float rotation = 0.0) {
+        this->position = position;
+        this->scale = scale;
+        this->rotation = rotation;
+    }
+};
+
+// Transforms are stored as a struct of arrays unless the game is built with -DTRANSFORM_LAYOUT_AOS
+#ifndef TRANSFORM_LAYOUT_AOS
+
+////////////////////////////////////////////////////////////////////////////////
+// Vec2Ref
+////////////////////////////////////////////////////////////////////////////////
+// Refers to a 2D vector whose x and y live in separate streams.
+////////////////////////////////////////////////////////////////////////////////
+struct Vec2Ref {
+    float& x;
+    float& y;
+
+    Vec2Ref(float& x, float& y): x(x), y(y) {};
+    Vec2Ref(const Vec2Ref& other) = default;
+
+    operator glm::vec2() const { return glm::vec2(x, y); }
+
+    Vec2Ref& operator =(const Vec2Ref& other) { x = other.x; y = other.y; return *this; }
+    Vec2Ref& operator =(const glm::vec2& value) { x = value.x; y = value.y; return *this; }
+    Vec2Ref& operator +=(const glm::vec2& value) { x += value.x; y += value.y; return *this; }
+    Vec2Ref& operator -=(const glm::vec2& value) { x -= value.x; y -= value.y; return *this; }
+    Vec2Ref& operator *=(float value) { x *= value; y *= value; return *this; }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// TransformRef
+////////////////////////////////////////////////////////////////////////////////
+// What GetComponent<TransformComponent>() hands out: it reads and writes the
+// fields of one transform, wherever they are stored, with the same member
+// names as TransformComponent.
+////////////////////////////////////////////////////////////////////////////////
+struct TransformRef {
+    Vec2Ref position;
+    Vec2Ref scale;
+    float& rotation;
+
+    TransformRef(float& positionX, float& positionY, float& scaleX, float& scaleY, float& rotation):
+        position(positionX, positionY), scale(scaleX, scaleY), rotation(rotation) {};
+    TransformRef(TransformComponent& transform):
+        position(transform.position.x, transform.position.y), scale(transform.scale.x, transform.scale.y), rotation(transform.rotation) {};
+    TransformRef(const TransformRef& other) = default;
+
+    operator TransformComponent() const { return TransformComponent(position, scale, rotation); }
+
+    // Copies the values, like assigning one TransformComponent& to another
+    TransformRef& operator =(const TransformRef& other) {
+        position = other.position;
+        scale = other.scale;
+        rotation = other.rotation;
+        return *this;
+    }
+
+    TransformRef& operator =(const TransformComponent& transform) {
+        position = transform.position;
+        scale = transform.scale;
+        rotation = transform.rotation;
+        return *this;
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// TransformStreams
+////////////////////////////////////////////////////////////////////////////////
+// Pool container that keeps each transform field in its own contiguous
+// stream, so a loop that only moves entities reads and writes nothing but
+// the position streams. Rotation is stored as a float.
+////////////////////////////////////////////////////////////////////////////////
+class TransformStreams {
+    private:
+        std::vector<float> positionX;
+        std::vector<float> positionY;
+        std::vector<float> scaleX;
+        std::vector<float> scaleY;
+        std::vector<float> rotation;
+
+    public:
+        using Reference = TransformRef;
+        using ConstReference = TransformComponent;
+
+        int GetSize() const { return static_cast<int>(positionX.size()); }
+        bool IsEmpty() const { return positionX.empty(); }
+
+        void Reserve(int capacity) {
+            positionX.reserve(capacity);
+            positionY.reserve(capacity);
+            scaleX.reserve(capacity);
+            scaleY.reserve(capacity);
+            rotation.reserve(capacity);
+        }
+
+        void Clear() {
+            positionX.clear();
+            positionY.clear();
+            scaleX.clear();
+            scaleY.clear();
+            rotation.clear();
+        }
+
+        std::size_t GetMemoryUsage() const {
+            return (positionX.capacity() + positionY.capacity() + scaleX.capacity() + scaleY.capacity() + rotation.capacity()) * sizeof(float);
+        }
+
+        void PushBack(const TransformComponent& transform) {
+            positionX.push_back(transform.position.x);
+            positionY.push_back(transform.position.y);
+            scaleX.push_back(transform.scale.x);
+            scaleY.push_back(transform.scale.y);
+            rotation.push_back(transform.rotation);
+        }
+
+        void Set(int index, const TransformComponent& transform) {
+            (*this)[index] = transform;
+        }
+
+        // Moves the last transform into the given slot and shrinks the streams by one
+        void SwapRemove(int index) {
+            int last = GetSize() - 1;
+            positionX[index] = positionX[last];
+            positionY[index] = positionY[last];
+            scaleX[index] = scaleX[last];
+            scaleY[index] = scaleY[last];
+            rotation[index] = rotation[last];
+            positionX.pop_back();
+            positionY.pop_back();
+            scaleX.pop_back();
+            scaleY.pop_back();
+            rotation.pop_back();
+        }
+
+        void Swap(int first, int second) {
+            std::swap(positionX[first], positionX[second]);
+            std::swap(positionY[first], positionY[second]);
+            std::swap(scaleX[first], scaleX[second]);
+            std::swap(scaleY[first], scaleY[second]);
+            std::swap(rotation[first], rotation[second]);
+        }
+
+        Reference operator [](int index) {
+            return TransformRef(positionX[index], positionY[index], scaleX[index], scaleY[index], rotation[index]);
+        }
+
+        ConstReference operator [](int index) const {
+            return TransformComponent(glm::vec2(positionX[index], positionY[index]), glm::vec2(scaleX[index], scaleY[index]), rotation[index]);
+        }
+
+        // Raw access to the streams, for loops that process many transforms at once
+        float* GetPositionX() { return positionX.data(); }
+        float* GetPositionY() { return positionY.data(); }
+        float* GetScaleX() { return scaleX.data(); }
+        float* GetScaleY() { return scaleY.data(); }
+        float* GetRotation() { return rotation.data(); }
+};
+
+template <>
+struct ComponentLayout<TransformComponent> {
+    using Container = TransformStreams;
+    using Reference = TransformRef;
+
+    static Reference MakeReference(TransformComponent& component) { return TransformRef(component); }
 };
 
 #endif
+
+#endif
@@ -0,0 +1,240 @@
+#include "ArchetypeStorage.h"
+#include <cassert>
+
+Archetype::Archetype(const Signature& signature, const ComponentInfo* componentInfos): signature(signature) {
+    columnOffsets.fill(-1);
+    versionOffsets.fill(-1);
+    componentSizes.fill(0);
+    archetypeWithComponent.fill(-1);
+    archetypeWithoutComponent.fill(-1);
+
+    std::size_t bytesPerRow = sizeof(int);
+    for (int componentId = 0; componentId < static_cast<int>(MAX_COMPONENTS); componentId++) {
+        if (signature.test(componentId)) {
+            componentIds.push_back(componentId);
+            componentSizes[componentId] = static_cast<int>(componentInfos[componentId].size);
+            bytesPerRow += componentInfos[componentId].size + sizeof(unsigned int);
+        }
+    }
+
+    // Start from the best case and shrink until the columns, with their alignment padding, fit in the chunk
+    for (chunkCapacity = static_cast<int>(ARCHETYPE_CHUNK_SIZE / bytesPerRow); chunkCapacity > 0; chunkCapacity--) {
+        std::size_t offset = sizeof(int) * chunkCapacity;
+        for (int componentId: componentIds) {
+            const ComponentInfo& info = componentInfos[componentId];
+            offset = (offset + info.alignment - 1) / info.alignment * info.alignment;
+            columnOffsets[componentId] = static_cast<int>(offset);
+            offset += info.size * chunkCapacity;
+            offset = (offset + alignof(unsigned int) - 1) / alignof(unsigned int) * alignof(unsigned int);
+            versionOffsets[componentId] = static_cast<int>(offset);
+            offset += sizeof(unsigned int) * chunkCapacity;
+        }
+        if (offset <= ARCHETYPE_CHUNK_SIZE) {
+            break;
+        }
+    }
+    assert(chunkCapacity > 0 && "Archetype row does not fit in a chunk");
+}
+
+ArchetypeStorage::~ArchetypeStorage() {
+    for (const auto& archetype: archetypes) {
+        for (const auto& chunk: archetype->chunks) {
+            for (int row = 0; row < chunk->count; row++) {
+                for (int componentId: archetype->componentIds) {
+                    componentInfos[componentId].destroy(archetype->GetComponent(*chunk, row, componentId));
+                }
+            }
+        }
+    }
+}
+
+int ArchetypeStorage::FindOrCreateArchetype(const Signature& signature) {
+    for (int i = 0; i < static_cast<int>(archetypes.size()); i++) {
+        if (archetypes[i]->signature == signature) {
+            return i;
+        }
+    }
+    archetypes.push_back(std::make_unique<Archetype>(signature, componentInfos.data()));
+    return static_cast<int>(archetypes.size()) - 1;
+}
+
+int ArchetypeStorage::GetArchetypeWith(int archetypeIndex, int componentId) {
+    if (archetypeIndex == -1) {
+        Signature signature;
+        signature.set(componentId);
+        return FindOrCreateArchetype(signature);
+    }
+    int& neighbour = archetypes[archetypeIndex]->archetypeWithComponent[componentId];
+    if (neighbour == -1) {
+        Signature signature = archetypes[archetypeIndex]->signature;
+        signature.set(componentId);
+        int targetIndex = FindOrCreateArchetype(signature);
+        archetypes[archetypeIndex]->archetypeWithComponent[componentId] = targetIndex;
+        return targetIndex;
+    }
+    return neighbour;
+}
+
+int ArchetypeStorage::GetArchetypeWithout(int archetypeIndex, int componentId) {
+    int& neighbour = archetypes[archetypeIndex]->archetypeWithoutComponent[componentId];
+    if (neighbour == -1) {
+        Signature signature = archetypes[archetypeIndex]->signature;
+        signature.reset(componentId);
+        // An entity without components does not live in any archetype
+        if (signature.none()) {
+            return -1;
+        }
+        int targetIndex = FindOrCreateArchetype(signature);
+        archetypes[archetypeIndex]->archetypeWithoutComponent[componentId] = targetIndex;
+        return targetIndex;
+    }
+    return neighbour;
+}
+
+ArchetypeStorage::EntityLocation ArchetypeStorage::AllocateRow(int archetypeIndex, int entityId) {
+    Archetype& archetype = *archetypes[archetypeIndex];
+    if (archetype.chunks.empty() || archetype.chunks.back()->count == archetype.chunkCapacity) {
+        archetype.chunks.push_back(std::make_unique<ArchetypeChunk>());
+    }
+    ArchetypeChunk& chunk = *archetype.chunks.back();
+
+    EntityLocation location;
+    location.archetypeIndex = archetypeIndex;
+    location.chunkIndex = archetype.GetNumChunks() - 1;
+    location.row = chunk.count++;
+    archetype.GetEntityIds(chunk)[location.row] = entityId;
+
+    entityLocations[entityId] = location;
+    return location;
+}
+
+void ArchetypeStorage::ReleaseRow(const EntityLocation& location) {
+    Archetype& archetype = *archetypes[location.archetypeIndex];
+    ArchetypeChunk& chunk = archetype.GetChunk(location.chunkIndex);
+    ArchetypeChunk& lastChunk = *archetype.chunks.back();
+    int lastRow = lastChunk.count - 1;
+
+    // Move the very last row of the archetype into the hole, so all chunks but the last stay full
+    if (&chunk != &lastChunk || location.row != lastRow) {
+        for (int componentId: archetype.componentIds) {
+            void* source = archetype.GetComponent(lastChunk, lastRow, componentId);
+            componentInfos[componentId].moveConstruct(archetype.GetComponent(chunk, location.row, componentId), source);
+            componentInfos[componentId].destroy(source);
+            archetype.GetVersions(chunk, componentId)[location.row] = archetype.GetVersions(lastChunk, componentId)[lastRow];
+        }
+        int movedEntityId = archetype.GetEntityIds(lastChunk)[lastRow];
+        archetype.GetEntityIds(chunk)[location.row] = movedEntityId;
+        entityLocations[movedEntityId] = location;
+    }
+
+    lastChunk.count--;
+    if (lastChunk.count == 0) {
+        archetype.chunks.pop_back();
+    }
+}
+
+void ArchetypeStorage::MoveEntity(int entityId, int targetArchetypeIndex) {
+    if (entityId >= static_cast<int>(entityLocations.size())) {
+        entityLocations.resize(entityId + 1);
+    }
+    EntityLocation source = entityLocations[entityId];
+
+    if (targetArchetypeIndex == -1) {
+        RemoveEntity(entityId);
+        return;
+    }
+
+    EntityLocation target = AllocateRow(targetArchetypeIndex, entityId);
+    if (source.archetypeIndex == -1) {
+        return;
+    }
+
+    Archetype& sourceArchetype = *archetypes[source.archetypeIndex];
+    Archetype& targetArchetype = *archetypes[target.archetypeIndex];
+    ArchetypeChunk& sourceChunk = sourceArchetype.GetChunk(source.chunkIndex);
+    ArchetypeChunk& targetChunk = targetArchetype.GetChunk(target.chunkIndex);
+
+    for (int componentId: sourceArchetype.componentIds) {
+        void* component = sourceArchetype.GetComponent(sourceChunk, source.row, componentId);
+        if (targetArchetype.HasColumn(componentId)) {
+            componentInfos[componentId].moveConstruct(targetArchetype.GetComponent(targetChunk, target.row, componentId), component);
+            targetArchetype.GetVersions(targetChunk, componentId)[target.row] = sourceArchetype.GetVersions(sourceChunk, componentId)[source.row];
+        } else {
+            structuralRevisions[componentId]++;
+        }
+        componentInfos[componentId].destroy(component);
+    }
+    ReleaseRow(source);
+}
+
+bool ArchetypeStorage::Has(int entityId, int componentId) const {
+    if (entityId >= static_cast<int>(entityLocations.size())) {
+        return false;
+    }
+    const EntityLocation& location = entityLocations[entityId];
+    return location.archetypeIndex != -1 && archetypes[location.archetypeIndex]->HasColumn(componentId);
+}
+
+void* ArchetypeStorage::Get(int entityId, int componentId) const {
+    assert(Has(entityId, componentId) && "Entity does not have a component of this type");
+    const EntityLocation& location = entityLocations[entityId];
+    const Archetype& archetype = *archetypes[location.archetypeIndex];
+    return archetype.GetComponent(archetype.GetChunk(location.chunkIndex), location.row, componentId);
+}
+
+void ArchetypeStorage::Add(int entityId, int componentId, void* component, unsigned int version) {
+    assert(componentInfos[componentId].isRegistered && "Component type was not registered");
+    const ComponentInfo& info = componentInfos[componentId];
+
+    // If the entity already has a component of this type, just replace it
+    if (Has(entityId, componentId)) {
+        void* existing = Get(entityId, componentId);
+        info.destroy(existing);
+        info.moveConstruct(existing, component);
+        SetVersion(entityId, componentId, version);
+        return;
+    }
+
+    int sourceArchetypeIndex = entityId < static_cast<int>(entityLocations.size()) ? entityLocations[entityId].archetypeIndex : -1;
+    MoveEntity(entityId, GetArchetypeWith(sourceArchetypeIndex, componentId));
+    info.moveConstruct(Get(entityId, componentId), component);
+    SetVersion(entityId, componentId, version);
+    structuralRevisions[componentId]++;
+}
+
+void ArchetypeStorage::SetVersion(int entityId, int componentId, unsigned int version) {
+    assert(Has(entityId, componentId) && "Entity does not have a component of this type");
+    const EntityLocation& location = entityLocations[entityId];
+    const Archetype& archetype = *archetypes[location.archetypeIndex];
+    archetype.GetVersions(archetype.GetChunk(location.chunkIndex), componentId)[location.row] = version;
+}
+
+void ArchetypeStorage::Remove(int entityId, int componentId) {
+    if (!Has(entityId, componentId)) {
+        return;
+    }
+    MoveEntity(entityId, GetArchetypeWithout(entityLocations[entityId].archetypeIndex, componentId));
+}
+
+std::size_t ArchetypeStorage::GetMemoryUsage() const {
+    std::size_t memoryUsage = entityLocations.capacity() * sizeof(EntityLocation);
+    for (const auto& archetype: archetypes) {
+        memoryUsage += archetype->chunks.size() * sizeof(ArchetypeChunk);
+    }
+    return memoryUsage;
+}
+
+void ArchetypeStorage::RemoveEntity(int entityId) {
+    if (entityId >= static_cast<int>(entityLocations.size()) || entityLocations[entityId].archetypeIndex == -1) {
+        return;
+    }
+    EntityLocation location = entityLocations[entityId];
+    Archetype& archetype = *archetypes[location.archetypeIndex];
+    ArchetypeChunk& chunk = archetype.GetChunk(location.chunkIndex);
+    for (int componentId: archetype.componentIds) {
+        componentInfos[componentId].destroy(archetype.GetComponent(chunk, location.row, componentId));
+        structuralRevisions[componentId]++;
+    }
+    ReleaseRow(location);
+    entityLocations[entityId] = EntityLocation();
+}
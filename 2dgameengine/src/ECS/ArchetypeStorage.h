@@ -0,0 +1,203 @@
+#ifndef ARCHETYPESTORAGE_H
+#define ARCHETYPESTORAGE_H
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+#include "Signature.h"
+
+// Size in bytes of the memory block that holds the rows of an archetype
+const std::size_t ARCHETYPE_CHUNK_SIZE = 16 * 1024;
+
+////////////////////////////////////////////////////////////////////////////////
+// ComponentInfo
+////////////////////////////////////////////////////////////////////////////////
+// What the archetype storage needs to know to move and destroy a component
+// without knowing its type.
+////////////////////////////////////////////////////////////////////////////////
+struct ComponentInfo {
+    bool isRegistered = false;
+    std::size_t size = 0;
+    std::size_t alignment = 1;
+    void (*moveConstruct)(void* destination, void* source) = nullptr;
+    void (*destroy)(void* component) = nullptr;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// ArchetypeChunk
+////////////////////////////////////////////////////////////////////////////////
+// A fixed-size block of memory holding up to "capacity" rows of an archetype.
+// The block starts with the entity ids of the rows, followed by one column per
+// component type, so every column is a plain contiguous array. Each column is
+// followed by the change versions of its components, one per row.
+////////////////////////////////////////////////////////////////////////////////
+struct alignas(64) ArchetypeChunk {
+    unsigned char memory[ARCHETYPE_CHUNK_SIZE];
+    int count = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Archetype
+////////////////////////////////////////////////////////////////////////////////
+// Groups all the entities that have exactly the same signature.
+////////////////////////////////////////////////////////////////////////////////
+class Archetype {
+    private:
+        Signature signature;
+
+        // Component ids stored by this archetype, in increasing order
+        std::vector<int> componentIds;
+
+        // Byte offset of each column inside a chunk [array index = component id], -1 if absent
+        std::array<int, MAX_COMPONENTS> columnOffsets;
+
+        // Byte offset of the change versions of each column inside a chunk [array index = component id], -1 if absent
+        std::array<int, MAX_COMPONENTS> versionOffsets;
+
+        // Size in bytes of each component [array index = component id]
+        std::array<int, MAX_COMPONENTS> componentSizes;
+
+        int chunkCapacity = 0;
+        std::vector<std::unique_ptr<ArchetypeChunk>> chunks;
+
+        // Cached neighbours of the archetype graph [array index = component id], -1 if not known yet
+        std::array<int, MAX_COMPONENTS> archetypeWithComponent;
+        std::array<int, MAX_COMPONENTS> archetypeWithoutComponent;
+
+        friend class ArchetypeStorage;
+
+    public:
+        Archetype(const Signature& signature, const ComponentInfo* componentInfos);
+
+        const Signature& GetSignature() const { return signature; }
+        int GetChunkCapacity() const { return chunkCapacity; }
+        int GetNumChunks() const { return static_cast<int>(chunks.size()); }
+        ArchetypeChunk& GetChunk(int chunkIndex) const { return *chunks[chunkIndex]; }
+
+        bool HasColumn(int componentId) const {
+            return columnOffsets[componentId] != -1;
+        }
+
+        int* GetEntityIds(ArchetypeChunk& chunk) const {
+            return reinterpret_cast<int*>(chunk.memory);
+        }
+
+        void* GetColumn(ArchetypeChunk& chunk, int componentId) const {
+            return chunk.memory + columnOffsets[componentId];
+        }
+
+        void* GetComponent(ArchetypeChunk& chunk, int row, int componentId) const {
+            return chunk.memory + columnOffsets[componentId] + row * componentSizes[componentId];
+        }
+
+        // Registry version at which each component of the column was last added or marked as changed
+        unsigned int* GetVersions(ArchetypeChunk& chunk, int componentId) const {
+            return reinterpret_cast<unsigned int*>(chunk.memory + versionOffsets[componentId]);
+        }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// ArchetypeStorage
+////////////////////////////////////////////////////////////////////////////////
+// Component storage that groups entities with the same signature into chunks,
+// as an alternative to one pool per component type. Adding or removing a
+// component moves the entity row to the archetype of its new signature, and
+// queries walk whole chunks of the archetypes that match, column by column.
+////////////////////////////////////////////////////////////////////////////////
+class ArchetypeStorage {
+    private:
+        struct EntityLocation {
+            int archetypeIndex = -1;
+            int chunkIndex = -1;
+            int row = -1;
+        };
+
+        std::array<ComponentInfo, MAX_COMPONENTS> componentInfos;
+        std::vector<std::unique_ptr<Archetype>> archetypes;
+
+        // Bumped every time an entity gains or loses a component of the type [array index = component id]
+        std::array<unsigned int, MAX_COMPONENTS> structuralRevisions{};
+
+        // Where the row of each entity lives [vector index = entity id]
+        std::vector<EntityLocation> entityLocations;
+
+        int FindOrCreateArchetype(const Signature& signature);
+        int GetArchetypeWith(int archetypeIndex, int componentId);
+        int GetArchetypeWithout(int archetypeIndex, int componentId);
+
+        // Appends an uninitialized row for the entity to the archetype
+        EntityLocation AllocateRow(int archetypeIndex, int entityId);
+
+        // Fills the hole left by a row whose components were already moved out or destroyed
+        void ReleaseRow(const EntityLocation& location);
+
+        // Moves the entity to another archetype, carrying over the components both have in common
+        void MoveEntity(int entityId, int targetArchetypeIndex);
+
+    public:
+        ArchetypeStorage() = default;
+        ~ArchetypeStorage();
+
+        ArchetypeStorage(const ArchetypeStorage&) = delete;
+        ArchetypeStorage& operator =(const ArchetypeStorage&) = delete;
+
+        template <typename T> void RegisterComponent(int componentId);
+
+        bool Has(int entityId, int componentId) const;
+        void* Get(int entityId, int componentId) const;
+
+        // Moves the component pointed by "component" into the entity's row, stamped with the given version
+        void Add(int entityId, int componentId, void* component, unsigned int version = 0);
+        void Remove(int entityId, int componentId);
+        void RemoveEntity(int entityId);
+
+        void SetVersion(int entityId, int componentId, unsigned int version);
+
+        // Moving rows between chunks or archetypes does not count, only entering or leaving the column
+        unsigned int GetStructuralRevision(int componentId) const { return structuralRevisions[componentId]; }
+
+        int GetNumArchetypes() const { return static_cast<int>(archetypes.size()); }
+
+        // Bytes allocated by the chunks and the entity locations
+        std::size_t GetMemoryUsage() const;
+
+        // Calls func(archetype, chunk) for every non-empty chunk whose archetype has all the required components
+        template <typename TFunc> void EachChunk(const Signature& required, TFunc&& func) const;
+};
+
+template <typename T>
+void ArchetypeStorage::RegisterComponent(int componentId) {
+    ComponentInfo& info = componentInfos[componentId];
+    if (info.isRegistered) {
+        return;
+    }
+    info.isRegistered = true;
+    info.size = sizeof(T);
+    info.alignment = alignof(T);
+    info.moveConstruct = [](void* destination, void* source) {
+        new (destination) T(std::move(*static_cast<T*>(source)));
+    };
+    info.destroy = [](void* component) {
+        static_cast<T*>(component)->~T();
+    };
+}
+
+template <typename TFunc>
+void ArchetypeStorage::EachChunk(const Signature& required, TFunc&& func) const {
+    for (const auto& archetype: archetypes) {
+        if (!archetype->GetSignature().Contains(required)) {
+            continue;
+        }
+        for (int chunkIndex = 0; chunkIndex < archetype->GetNumChunks(); chunkIndex++) {
+            ArchetypeChunk& chunk = archetype->GetChunk(chunkIndex);
+            if (chunk.count > 0) {
+                func(*archetype, chunk);
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef COMPONENTLAYOUT_H
+#define COMPONENTLAYOUT_H
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Components deriving from TagComponent (e.g. "struct EnemyTag: TagComponent {};") are
+// tags: they only exist as a bit of the entity signature and never get a pool or
+// archetype column. Other empty structs are stored like any other component.
+struct TagComponent {};
+
+template <typename T>
+constexpr bool IS_TAG_COMPONENT = std::is_base_of<TagComponent, T>::value;
+
+////////////////////////////////////////////////////////////////////////////////
+// DenseArray
+////////////////////////////////////////////////////////////////////////////////
+// The default container of a component pool: a plain array of structs.
+////////////////////////////////////////////////////////////////////////////////
+template <typename T>
+class DenseArray {
+    private:
+        std::vector<T> items;
+
+    public:
+        using Reference = T&;
+        using ConstReference = const T&;
+
+        int GetSize() const { return static_cast<int>(items.size()); }
+        bool IsEmpty() const { return items.empty(); }
+        void Reserve(int capacity) { items.reserve(capacity); }
+        void Clear() { items.clear(); }
+        std::size_t GetMemoryUsage() const { return items.capacity() * sizeof(T); }
+
+        void PushBack(T object) { items.push_back(std::move(object)); }
+        void Set(int index, T object) { items[index] = std::move(object); }
+
+        // Moves the last element into the given slot and shrinks the array by one
+        void SwapRemove(int index) {
+            if (index != GetSize() - 1) {
+                items[index] = std::move(items.back());
+            }
+            items.pop_back();
+        }
+
+        void Swap(int first, int second) {
+            std::swap(items[first], items[second]);
+        }
+
+        Reference operator [](int index) { return items[index]; }
+        ConstReference operator [](int index) const { return items[index]; }
+
+        T* GetData() { return items.data(); }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// ComponentLayout
+////////////////////////////////////////////////////////////////////////////////
+// Decides how the pool of a component type lays out its data in memory. By
+// default components are stored as an array of structs and handed out as
+// plain references. A component can specialize this trait to store its
+// fields in separate streams (struct of arrays) and hand out a proxy that
+// refers to its fields instead. Tags have nothing to refer to, so they are
+// handed out by value.
+////////////////////////////////////////////////////////////////////////////////
+template <typename T>
+struct ComponentLayout {
+    using Container = DenseArray<T>;
+    using Reference = typename std::conditional<IS_TAG_COMPONENT<T>, T, T&>::type;
+
+    // Wraps a component that lives outside a pool (e.g. in an archetype chunk)
+    static Reference MakeReference(T& component) { return component; }
+};
+
+// The type that GetComponent<T>() and the views hand out for a component of type T
+template <typename T>
+using ComponentRef = typename ComponentLayout<T>::Reference;
+
+#endif
@@ -1,24 +1,460 @@
 #include "ECS.h"
-#include <algorithm>
 
 int Entity::GetId() const {
-    return id;
+    return static_cast<int>(handle & ENTITY_INDEX_MASK);
+}
+
+int Entity::GetGeneration() const {
+    return static_cast<int>((handle >> ENTITY_INDEX_BITS) & ENTITY_GENERATION_MASK);
+}
+
+void Entity::Kill() {
+    registry->KillEntity(*this);
+}
+
+bool Entity::IsAlive() const {
+    return registry->IsAlive(*this);
+}
+
+void Entity::Tag(const std::string& tag) {
+    registry->TagEntity(*this, tag);
+}
+
+bool Entity::HasTag(const std::string& tag) const {
+    return registry->EntityHasTag(*this, tag);
+}
+
+void Entity::Group(const std::string& group) {
+    registry->GroupEntity(*this, group);
+}
+
+bool Entity::BelongsToGroup(const std::string& group) const {
+    return registry->EntityBelongsToGroup(*this, group);
 }
 
 void System::AddEntityToSystem(Entity entity) {
+    assert(activeViews == 0 && "Entity added to a system while its entities are being iterated");
+    if (HasEntity(entity)) {
+        return;
+    }
+    const auto entityId = entity.GetId();
+    if (entityId >= static_cast<int>(entityIdToSlot.size())) {
+        entityIdToSlot.resize(entityId + 1, -1);
+    }
+    entityIdToSlot[entityId] = static_cast<int>(entities.size());
     entities.push_back(entity);
+    OnEntityAdded(entity);
 }
 
 void System::RemoveEntityFromSystem(Entity entity) {
-    entities.erase(std::remove_if(entities.begin(), entities.end(), [&entity](Entity other) {
-        return entity == other;
-    }), entities.end());
+    assert(activeViews == 0 && "Entity removed from a system while its entities are being iterated");
+    if (!HasEntity(entity)) {
+        return;
+    }
+    // Swap the last entity into the removed slot and pop the back, so removal is O(1)
+    const auto entityId = entity.GetId();
+    int slotOfRemoved = entityIdToSlot[entityId];
+    Entity lastEntity = entities.back();
+    entities[slotOfRemoved] = lastEntity;
+    entityIdToSlot[lastEntity.GetId()] = slotOfRemoved;
+    entities.pop_back();
+    entityIdToSlot[entityId] = -1;
+    OnEntityRemoved(entity);
+}
+
+bool System::HasEntity(Entity entity) const {
+    const auto entityId = entity.GetId();
+    if (entityId >= static_cast<int>(entityIdToSlot.size()) || entityIdToSlot[entityId] == -1) {
+        return false;
+    }
+    // The slot may belong to an older entity that used the same index
+    return entities[entityIdToSlot[entityId]] == entity;
 }
 
-std::vector<Entity> System::GetSystemEntities() const {
-    return entities;
+EntityView System::GetSystemEntities() const {
+    return EntityView(entities.data(), entities.size(), &activeViews);
 }
 
 const Signature& System::GetComponentSignature() const {
     return componentSignature;
 }
+
+const Signature& System::GetReadSignature() const {
+    return readSignature;
+}
+
+const Signature& System::GetWriteSignature() const {
+    return writeSignature;
+}
+
+bool System::ConflictsWith(const System& other) const {
+    // Systems that did not declare what they access have to run on their own
+    if ((readSignature | writeSignature).none() || (other.readSignature | other.writeSignature).none()) {
+        return true;
+    }
+    // Two systems conflict when one writes something that the other reads or writes
+    return (writeSignature & (other.readSignature | other.writeSignature)).any() ||
+           (other.writeSignature & readSignature).any();
+}
+
+Entity Registry::CreateEntity() {
+    std::lock_guard<std::mutex> lock(commandMutex);
+    int entityId;
+
+    if (freeIds.empty()) {
+        // If there are no free ids waiting to be reused, hand out a fresh index.
+        // The per-entity arrays are only grown by the next flush, so systems running
+        // in parallel can keep reading them while this one spawns entities.
+        if (numEntities >= static_cast<int>(MAX_ENTITIES)) {
+            // Hand back the invalid entity, which no later CreateEntity() can bring to life
+            Logger::Err("Maximum number of entities reached.");
+            return GetInvalidEntity();
+        }
+        entityId = numEntities++;
+    } else {
+        // Reuse an index from a previously killed entity (its generation was already bumped)
+        entityId = freeIds.front();
+        freeIds.pop_front();
+        isIdFree[entityId].store(false, std::memory_order_relaxed);
+    }
+
+    Entity entity(entityId, GetGenerationOf(entityId));
+    entity.registry = this;
+    pendingCommands.push_back({COMMAND_CREATE_ENTITY, entity, -1, -1});
+
+    return entity;
+}
+
+void Registry::KillEntity(Entity entity) {
+    if (!IsAlive(entity)) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(commandMutex);
+    pendingCommands.push_back({COMMAND_KILL_ENTITY, entity, -1, -1});
+}
+
+int Registry::GetGenerationOf(int entityId) const {
+    // Indices handed out since the last flush have no slot yet, and fresh indices start at generation 0
+    return entityId < static_cast<int>(entityGenerations.size()) ? entityGenerations[entityId] : 0;
+}
+
+bool Registry::IsIdFree(int entityId) const {
+    // Indices handed out since the last flush have no slot yet, and they are all in use
+    return entityId < static_cast<int>(isIdFree.size()) && isIdFree[entityId].load(std::memory_order_relaxed);
+}
+
+bool Registry::IsAlive(Entity entity) const {
+    const auto entityId = entity.GetId();
+    if (entityId == INVALID_ENTITY_ID) {
+        return false;
+    }
+    return entityId < numEntities && GetGenerationOf(entityId) == entity.GetGeneration() && !IsIdFree(entityId);
+}
+
+int Registry::GetNumEntities() const {
+    std::lock_guard<std::mutex> lock(commandMutex);
+    return numEntities - static_cast<int>(freeIds.size());
+}
+
+Entity Registry::GetEntityById(int entityId) const {
+    // Free and out of range indices get the invalid entity rather than a handle built
+    // from their generation, which the next owner of the index would share
+    if (entityId < 0 || entityId >= numEntities || IsIdFree(entityId)) {
+        return GetInvalidEntity();
+    }
+    Entity entity(entityId, GetGenerationOf(entityId));
+    entity.registry = const_cast<Registry*>(this);
+    return entity;
+}
+
+Entity Registry::GetInvalidEntity() const {
+    Entity invalidEntity(INVALID_ENTITY_ID);
+    invalidEntity.registry = const_cast<Registry*>(this);
+    return invalidEntity;
+}
+
+void Registry::TagEntity(Entity entity, const std::string& tag) {
+    if (!IsAlive(entity)) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(commandMutex);
+    stagedNames.push_back(tag);
+    pendingCommands.push_back({COMMAND_TAG_ENTITY, entity, -1, static_cast<int>(stagedNames.size()) - 1});
+}
+
+bool Registry::EntityHasTag(Entity entity, const std::string& tag) const {
+    auto entityWithTag = entityPerTag.find(tag);
+    return entityWithTag != entityPerTag.end() && entityWithTag->second == entity;
+}
+
+void Registry::RemoveEntityTag(Entity entity) {
+    if (!IsAlive(entity)) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(commandMutex);
+    pendingCommands.push_back({COMMAND_REMOVE_TAG, entity, -1, -1});
+}
+
+Entity Registry::GetEntityByTag(const std::string& tag) const {
+    auto entityWithTag = entityPerTag.find(tag);
+    if (entityWithTag == entityPerTag.end()) {
+        return GetInvalidEntity();
+    }
+    return entityWithTag->second;
+}
+
+void Registry::GroupEntity(Entity entity, const std::string& group) {
+    if (!IsAlive(entity)) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(commandMutex);
+    stagedNames.push_back(group);
+    pendingCommands.push_back({COMMAND_GROUP_ENTITY, entity, -1, static_cast<int>(stagedNames.size()) - 1});
+}
+
+bool Registry::EntityBelongsToGroup(Entity entity, const std::string& group) const {
+    if (!IsAlive(entity)) {
+        return false;
+    }
+    auto groupOfEntity = groupPerEntity.find(entity.GetId());
+    return groupOfEntity != groupPerEntity.end() && groupOfEntity->second == group;
+}
+
+void Registry::RemoveEntityGroup(Entity entity) {
+    if (!IsAlive(entity)) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(commandMutex);
+    pendingCommands.push_back({COMMAND_REMOVE_GROUP, entity, -1, -1});
+}
+
+const std::vector<Entity>& Registry::GetEntitiesByGroup(const std::string& group) const {
+    static const std::vector<Entity> emptyGroup;
+    auto entitiesOfGroup = entitiesPerGroup.find(group);
+    return entitiesOfGroup != entitiesPerGroup.end() ? entitiesOfGroup->second : emptyGroup;
+}
+
+void Registry::ApplyTag(Entity entity, const std::string& tag) {
+    EraseTag(entity.GetId());
+    // The tag moves over from the entity that had it before, if any
+    auto entityWithTag = entityPerTag.find(tag);
+    if (entityWithTag != entityPerTag.end()) {
+        tagPerEntity.erase(entityWithTag->second.GetId());
+        entityWithTag->second = entity;
+    } else {
+        entityPerTag.emplace(tag, entity);
+    }
+    tagPerEntity[entity.GetId()] = tag;
+}
+
+void Registry::EraseTag(int entityId) {
+    auto tagOfEntity = tagPerEntity.find(entityId);
+    if (tagOfEntity == tagPerEntity.end()) {
+        return;
+    }
+    entityPerTag.erase(tagOfEntity->second);
+    tagPerEntity.erase(tagOfEntity);
+}
+
+void Registry::ApplyGroup(Entity entity, const std::string& group) {
+    EraseGroup(entity.GetId());
+    std::vector<Entity>& entitiesOfGroup = entitiesPerGroup[group];
+    groupSlotPerEntity[entity.GetId()] = static_cast<int>(entitiesOfGroup.size());
+    entitiesOfGroup.push_back(entity);
+    groupPerEntity[entity.GetId()] = group;
+}
+
+void Registry::EraseGroup(int entityId) {
+    auto groupOfEntity = groupPerEntity.find(entityId);
+    if (groupOfEntity == groupPerEntity.end()) {
+        return;
+    }
+    // Swap the last entity of the group into the hole, so the group stays packed
+    std::vector<Entity>& entitiesOfGroup = entitiesPerGroup[groupOfEntity->second];
+    int slotOfRemoved = groupSlotPerEntity[entityId];
+    Entity lastEntity = entitiesOfGroup.back();
+    entitiesOfGroup[slotOfRemoved] = lastEntity;
+    groupSlotPerEntity[lastEntity.GetId()] = slotOfRemoved;
+    entitiesOfGroup.pop_back();
+    groupSlotPerEntity[entityId] = -1;
+    groupPerEntity.erase(groupOfEntity);
+}
+
+void Registry::RemoveEntityFromSystems(Entity entity) {
+    for (auto& system: systems) {
+        system.second->RemoveEntityFromSystem(entity);
+    }
+}
+
+void Registry::UpdateEntityInSystems(Entity entity) {
+    const auto& entityComponentSignature = entityComponentSignatures[entity.GetId()];
+
+    for (auto& system: systems) {
+        const auto& systemComponentSignature = system.second->GetComponentSignature();
+
+        bool isInterested = entityComponentSignature.Contains(systemComponentSignature);
+        if (isInterested) {
+            system.second->AddEntityToSystem(entity);
+        } else {
+            system.second->RemoveEntityFromSystem(entity);
+        }
+    }
+}
+
+void Registry::FlagEntityForMatching(Entity entity) {
+    const auto entityId = entity.GetId();
+    if (!entityNeedsMatching[entityId]) {
+        entityNeedsMatching[entityId] = true;
+        entitiesToBeMatched.push_back(entity);
+    }
+}
+
+void Registry::DestroyEntity(Entity entity) {
+    RemoveEntityFromSystems(entity);
+
+    const auto entityId = entity.GetId();
+    if (storageMode == STORAGE_ARCHETYPES) {
+        archetypeStorage.RemoveEntity(entityId);
+    } else {
+        // Only visit the pools of the components the entity has, tags have no pool
+        entityComponentSignatures[entityId].ForEachSetBit([this, entityId](std::size_t componentId) {
+            if (componentPools[componentId]) {
+                componentPools[componentId]->RemoveEntityFromPool(entityId);
+            }
+        });
+    }
+    entityComponentSignatures[entityId].reset();
+    EraseTag(entityId);
+    EraseGroup(entityId);
+
+    // Bump the generation so that any handle still pointing to this index becomes stale
+    entityGenerations[entityId] = (entityGenerations[entityId] + 1) & ENTITY_GENERATION_MASK;
+
+    // Make the entity index available to be reused, until then no handle to it is alive
+    freeIds.push_back(entityId);
+    isIdFree[entityId].store(true, std::memory_order_relaxed);
+}
+
+void Registry::ExecuteCommand(const EntityCommand& command) {
+    // Commands recorded for an entity that was killed earlier in the same flush are dropped
+    if (!IsAlive(command.entity)) {
+        return;
+    }
+    const auto entityId = command.entity.GetId();
+
+    switch (command.type) {
+        case COMMAND_CREATE_ENTITY:
+            FlagEntityForMatching(command.entity);
+            break;
+        case COMMAND_KILL_ENTITY:
+            DestroyEntity(command.entity);
+            break;
+        case COMMAND_ADD_COMPONENT:
+            // Tags are recorded without staged data and only live in the signature
+            if (command.stagingIndex != -1) {
+                IStagedComponents& staged = *stagedComponents[command.componentId];
+                // Pools are only created here, while no system is reading them
+                if (!componentPools[command.componentId]) {
+                    componentPools[command.componentId] = staged.CreatePool();
+                    if (storageMode == STORAGE_ARCHETYPES) {
+                        staged.RegisterComponent(archetypeStorage, command.componentId);
+                    }
+                }
+                if (storageMode == STORAGE_ARCHETYPES) {
+                    archetypeStorage.Add(entityId, command.componentId, staged.Get(command.stagingIndex), changeVersion);
+                } else {
+                    staged.Commit(*componentPools[command.componentId], entityId, command.stagingIndex, changeVersion);
+                }
+            }
+            entityComponentSignatures[entityId].set(command.componentId);
+            FlagEntityForMatching(command.entity);
+            break;
+        case COMMAND_REMOVE_COMPONENT:
+            if (storageMode == STORAGE_ARCHETYPES) {
+                archetypeStorage.Remove(entityId, command.componentId);
+            } else if (componentPools[command.componentId]) {
+                componentPools[command.componentId]->RemoveEntityFromPool(entityId);
+            }
+            entityComponentSignatures[entityId].reset(command.componentId);
+            FlagEntityForMatching(command.entity);
+            break;
+        case COMMAND_TAG_ENTITY:
+            ApplyTag(command.entity, stagedNames[command.stagingIndex]);
+            break;
+        case COMMAND_REMOVE_TAG:
+            EraseTag(entityId);
+            break;
+        case COMMAND_GROUP_ENTITY:
+            ApplyGroup(command.entity, stagedNames[command.stagingIndex]);
+            break;
+        case COMMAND_REMOVE_GROUP:
+            EraseGroup(entityId);
+            break;
+    }
+}
+
+void Registry::Update() {
+    std::lock_guard<std::mutex> lock(commandMutex);
+
+    // The flush and the systems that run after it share a new version
+    changeVersion++;
+
+    // Make room for the entities created since the last flush
+    if (numEntities > static_cast<int>(entityGenerations.size())) {
+        entityComponentSignatures.resize(numEntities);
+        entityGenerations.resize(numEntities, 0);
+        entityNeedsMatching.resize(numEntities, false);
+        groupSlotPerEntity.resize(numEntities, -1);
+        while (static_cast<int>(isIdFree.size()) < numEntities) {
+            isIdFree.emplace_back(false);
+        }
+    }
+
+    // Apply the structural changes in the order they were requested
+    for (const auto& command: pendingCommands) {
+        ExecuteCommand(command);
+    }
+    pendingCommands.clear();
+    stagedNames.clear();
+
+    for (auto& staged: stagedComponents) {
+        if (staged) {
+            staged->Clear();
+        }
+    }
+
+    // Match every entity that was touched against the systems, once per flush
+    for (auto entity: entitiesToBeMatched) {
+        entityNeedsMatching[entity.GetId()] = false;
+        if (IsAlive(entity)) {
+            UpdateEntityInSystems(entity);
+        }
+    }
+    entitiesToBeMatched.clear();
+}
+
+int Registry::GetNumComponents(int componentId) const {
+    if (storageMode == STORAGE_POOLS && componentPools[componentId]) {
+        return componentPools[componentId]->GetSize();
+    }
+    int numComponents = 0;
+    for (const auto& signature: entityComponentSignatures) {
+        if (signature.test(componentId)) {
+            numComponents++;
+        }
+    }
+    return numComponents;
+}
+
+std::size_t Registry::GetPoolMemoryUsage(int componentId) const {
+    std::size_t memoryUsage = componentPools[componentId] ? componentPools[componentId]->GetMemoryUsage() : 0;
+    std::lock_guard<std::mutex> lock(commandMutex);
+    if (stagedComponents[componentId]) {
+        memoryUsage += stagedComponents[componentId]->GetMemoryUsage();
+    }
+    return memoryUsage;
+}
+
+std::size_t Registry::GetArchetypeMemoryUsage() const {
+    return storageMode == STORAGE_ARCHETYPES ? archetypeStorage.GetMemoryUsage() : 0;
+}
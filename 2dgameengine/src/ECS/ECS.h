@@ -2,80 +2,1054 @@
 #define ECS_H
 
 #include <vector>
-#include <bitset>
+#include <deque>
+#include <cstdint>
+#include <cassert>
+#include <memory>
+#include <typeindex>
+#include <unordered_map>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include "TypeList.h"
+#include "ComponentLayout.h"
+#include "Signature.h"
+#include "ArchetypeStorage.h"
+#include "../Components/ComponentTypes.h"
+#include "../Logger/Logger.h"
 
-const unsigned int MAX_COMPONENTS = 32;
+// Used to assign a unique id to a component type. The id is the position of the
+// type in ComponentTypes, so it is a compile-time constant.
+template <typename T>
+class Component {
+    public:
+        static constexpr int id = TypeIndex<T, ComponentTypes>::value;
+
+        // Returns the unique id of Component<T>
+        static constexpr int GetId() {
+            return id;
+        }
+};
+
+static_assert(ComponentTypes::size <= static_cast<int>(MAX_COMPONENTS), "Too many component types for MAX_COMPONENTS");
 
 ////////////////////////////////////////////////////////////////////////////////
-// Signature
+// Entity
 ////////////////////////////////////////////////////////////////////////////////
-// We use a bitset (1s and 0s) to keep track of which components an entity has,
-// and also helps keep track of which entities a system is interested in.
+// An entity is a 32-bit handle. The low bits are the index of the entity (used
+// to address signatures and component pools) and the high bits hold a
+// generation that is bumped every time the index is recycled, so a handle
+// that outlives its entity can be told apart from the new owner of the index.
 ////////////////////////////////////////////////////////////////////////////////
-typedef std::bitset<MAX_COMPONENTS> Signature;
+const unsigned int ENTITY_INDEX_BITS = 20;
+const unsigned int ENTITY_GENERATION_BITS = 32 - ENTITY_INDEX_BITS;
+const std::uint32_t ENTITY_INDEX_MASK = (1u << ENTITY_INDEX_BITS) - 1;
+const std::uint32_t ENTITY_GENERATION_MASK = (1u << ENTITY_GENERATION_BITS) - 1;
 
-struct IComponent {
-    protected:
-        static int nextId;
-};
-
-// Used to assign a unique id to a component type
-template <typename T>
-class Component: public IComponent {
-    // Returns the unique id of Component<T>
-    static int GetId() {
-        static auto id = nextId++;
-        return id;
-    }
-};
+// The last index is never handed out, so a handle pointing to it can never come alive
+const int INVALID_ENTITY_ID = static_cast<int>(ENTITY_INDEX_MASK);
+const unsigned int MAX_ENTITIES = ENTITY_INDEX_MASK;
 
 class Entity {
     private:
-        int id;
+        std::uint32_t handle;
 
     public:
-        Entity(int id): id(id) {};
+        Entity(int id, int generation = 0):
+            handle((static_cast<std::uint32_t>(generation) & ENTITY_GENERATION_MASK) << ENTITY_INDEX_BITS |
+                   (static_cast<std::uint32_t>(id) & ENTITY_INDEX_MASK)) {};
         Entity(const Entity& entity) = default;
+
+        // Returns the index part of the handle
         int GetId() const;
-       
+
+        // Returns the generation part of the handle
+        int GetGeneration() const;
+
+        void Kill();
+        bool IsAlive() const;
+
+        // Shortcuts to manage the tag and the group of this entity through its registry
+        void Tag(const std::string& tag);
+        bool HasTag(const std::string& tag) const;
+        void Group(const std::string& group);
+        bool BelongsToGroup(const std::string& group) const;
+
         Entity& operator =(const Entity& other) = default;
-        bool operator ==(const Entity& other) const { return id == other.id; }
-        bool operator !=(const Entity& other) const { return id != other.id; }
-        bool operator >(const Entity& other) const { return id > other.id; }
-        bool operator <(const Entity& other) const { return id < other.id; }
+        bool operator ==(const Entity& other) const { return handle == other.handle; }
+        bool operator !=(const Entity& other) const { return handle != other.handle; }
+        bool operator >(const Entity& other) const { return handle > other.handle; }
+        bool operator <(const Entity& other) const { return handle < other.handle; }
+
+        // Shortcuts to manage the components of this entity through its registry
+        template <typename TComponent, typename ...TArgs> void AddComponent(TArgs&& ...args);
+        template <typename TComponent> void RemoveComponent();
+        template <typename TComponent> bool HasComponent() const;
+        template <typename TComponent> ComponentRef<TComponent> GetComponent() const;
+
+        // Holds a pointer to the entity's owner registry
+        class Registry* registry = nullptr;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// EntityView
+////////////////////////////////////////////////////////////////////////////////
+// A non-owning view over the entities of a system. It points straight into the
+// system's own array, so no copy is made. While any view of a system is alive
+// the system rejects structural changes, which catches entities being added or
+// removed in the middle of a loop that iterates them.
+////////////////////////////////////////////////////////////////////////////////
+class EntityView {
+    private:
+        const Entity* first;
+        std::size_t count;
+        int* activeViews;
+
+    public:
+        EntityView(const Entity* first, std::size_t count, int* activeViews):
+            first(first), count(count), activeViews(activeViews) {
+            ++*activeViews;
+        }
+        EntityView(const EntityView& other):
+            first(other.first), count(other.count), activeViews(other.activeViews) {
+            ++*activeViews;
+        }
+        EntityView& operator =(const EntityView& other) = delete;
+        ~EntityView() {
+            --*activeViews;
+        }
+
+        const Entity* begin() const { return first; }
+        const Entity* end() const { return first + count; }
+        std::size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+        const Entity& operator [](std::size_t index) const { return first[index]; }
 };
 
 ////////////////////////////////////////////////////////////////////////////////
 // System
 ////////////////////////////////////////////////////////////////////////////////
-// The system processes entities that contain a specific signature
+// The system processes entities that contain a specific signature.
+// Besides the components it requires, a system declares the components it
+// reads and writes, so the SystemScheduler can run systems that don't touch
+// the same data at the same time. Adding or removing a component type from
+// entities, or reordering its pool, counts as writing it. A system that
+// declares no access at all is assumed to touch everything.
 ////////////////////////////////////////////////////////////////////////////////
 class System {
     private:
         Signature componentSignature;
+        Signature readSignature;
+        Signature writeSignature;
         std::vector<Entity> entities;
 
+        // Maps an entity id to its slot in the entities vector (-1 if absent)
+        std::vector<int> entityIdToSlot;
+
+        // Number of EntityViews currently iterating this system's entities
+        mutable int activeViews = 0;
+
+    protected:
+        // The registry that owns the system, set by Registry::AddSystem
+        class Registry* registry = nullptr;
+
+        friend class Registry;
+
     public:
         System() = default;
-        ~System() = default;
-        
+        virtual ~System() = default;
+
         void AddEntityToSystem(Entity entity);
         void RemoveEntityFromSystem(Entity entity);
-        std::vector<Entity> GetSystemEntities() const;
+        bool HasEntity(Entity entity) const;
+        EntityView GetSystemEntities() const;
         const Signature& GetComponentSignature() const;
+        const Signature& GetReadSignature() const;
+        const Signature& GetWriteSignature() const;
+
+        // Returns true if the two systems may not run at the same time
+        bool ConflictsWith(const System& other) const;
+
+        // Processes the entities of the system, called once per frame by the SystemScheduler
+        virtual void Update(double) {};
+
+        // Called during the registry flush when an entity starts or stops matching the
+        // components the system requires (killed entities stop matching too)
+        virtual void OnEntityAdded(Entity) {};
+        virtual void OnEntityRemoved(Entity) {};
+
+        // Name shown in the profiler, must be a string literal
+        virtual const char* GetName() const { return "System"; }
 
         // Defines the component type that entities must have to be considered by the system
         template <typename TComponent> void RequireComponent();
+
+        // Declares that the system reads/writes the data of a component type
+        template <typename TComponent> void ReadsComponent();
+        template <typename TComponent> void WritesComponent();
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Pool
+////////////////////////////////////////////////////////////////////////////////
+// A pool is a sparse set of components of a single type. The component data
+// lives in a dense vector with no holes, so iterating a pool is a linear walk
+// over contiguous memory. A sparse array indexed by entity id gives the slot
+// of each entity in the dense vector, which makes add/remove/get O(1).
+// The dense container is picked by ComponentLayout<T>, so a component type
+// can opt into a struct-of-arrays layout.
+////////////////////////////////////////////////////////////////////////////////
+class IPool {
+    public:
+        virtual ~IPool() = default;
+        virtual int GetSize() const = 0;
+        virtual const std::vector<int>& GetEntityIds() const = 0;
+        virtual int GetIndexOf(int entityId) const = 0;
+        virtual void SwapSlots(int first, int second) = 0;
+        virtual unsigned int GetLayoutRevision() const = 0;
+        virtual std::size_t GetMemoryUsage() const = 0;
+        virtual void RemoveEntityFromPool(int entityId) = 0;
+};
+
+template <typename T>
+class Pool: public IPool {
+    public:
+        using Container = typename ComponentLayout<T>::Container;
+        using Reference = typename Container::Reference;
+        using ConstReference = typename Container::ConstReference;
+
+    private:
+        // Densely packed component data
+        Container data;
+
+        // Maps a slot of the dense vector to the id of the entity that owns it
+        std::vector<int> indexToEntityId;
+
+        // Maps an entity id to its slot in the dense vector (-1 if absent)
+        std::vector<int> entityIdToIndex;
+
+        // Registry version at which each component was last added or marked as changed
+        // [vector index = slot of the dense vector]
+        std::vector<unsigned int> versions;
+
+        // Bumped every time an entity enters, leaves or changes slot in the dense arrays
+        unsigned int layoutRevision = 0;
+
+    public:
+        Pool(int capacity = 100) {
+            data.Reserve(capacity);
+            indexToEntityId.reserve(capacity);
+            versions.reserve(capacity);
+        }
+        virtual ~Pool() = default;
+
+        bool IsEmpty() const {
+            return data.IsEmpty();
+        }
+
+        int GetSize() const override {
+            return data.GetSize();
+        }
+
+        void Clear() {
+            data.Clear();
+            indexToEntityId.clear();
+            entityIdToIndex.clear();
+            versions.clear();
+        }
+
+        bool Has(int entityId) const {
+            return entityId >= 0 &&
+                entityId < static_cast<int>(entityIdToIndex.size()) &&
+                entityIdToIndex[entityId] != -1;
+        }
+
+        void Set(int entityId, T object, unsigned int version = 0) {
+            if (Has(entityId)) {
+                // The entity already owns a component of this type, so just replace it
+                data.Set(entityIdToIndex[entityId], std::move(object));
+                versions[entityIdToIndex[entityId]] = version;
+                return;
+            }
+            if (entityId >= static_cast<int>(entityIdToIndex.size())) {
+                entityIdToIndex.resize(entityId + 1, -1);
+            }
+            entityIdToIndex[entityId] = GetSize();
+            indexToEntityId.push_back(entityId);
+            data.PushBack(std::move(object));
+            versions.push_back(version);
+            layoutRevision++;
+        }
+
+        void Remove(int entityId) {
+            if (!Has(entityId)) {
+                return;
+            }
+            // Move the last element into the removed slot to keep the data packed
+            int indexOfRemoved = entityIdToIndex[entityId];
+            int indexOfLast = GetSize() - 1;
+            if (indexOfRemoved != indexOfLast) {
+                int entityIdOfLast = indexToEntityId[indexOfLast];
+                indexToEntityId[indexOfRemoved] = entityIdOfLast;
+                entityIdToIndex[entityIdOfLast] = indexOfRemoved;
+                versions[indexOfRemoved] = versions[indexOfLast];
+            }
+            data.SwapRemove(indexOfRemoved);
+            indexToEntityId.pop_back();
+            versions.pop_back();
+            entityIdToIndex[entityId] = -1;
+            layoutRevision++;
+        }
+
+        int GetIndexOf(int entityId) const override {
+            return Has(entityId) ? entityIdToIndex[entityId] : -1;
+        }
+
+        // Exchanges the slots of two entities in the dense arrays
+        void SwapSlots(int first, int second) override {
+            if (first == second) {
+                return;
+            }
+            data.Swap(first, second);
+            std::swap(indexToEntityId[first], indexToEntityId[second]);
+            std::swap(versions[first], versions[second]);
+            entityIdToIndex[indexToEntityId[first]] = first;
+            entityIdToIndex[indexToEntityId[second]] = second;
+            layoutRevision++;
+        }
+
+        unsigned int GetLayoutRevision() const override {
+            return layoutRevision;
+        }
+
+        // Bytes allocated by the pool, including the room reserved for growth
+        std::size_t GetMemoryUsage() const override {
+            return data.GetMemoryUsage() +
+                (indexToEntityId.capacity() + entityIdToIndex.capacity()) * sizeof(int) +
+                versions.capacity() * sizeof(unsigned int);
+        }
+
+        void RemoveEntityFromPool(int entityId) override {
+            Remove(entityId);
+        }
+
+        Reference Get(int entityId) {
+            assert(Has(entityId) && "Entity does not have a component of this type");
+            return data[entityIdToIndex[entityId]];
+        }
+
+        ConstReference Get(int entityId) const {
+            assert(Has(entityId) && "Entity does not have a component of this type");
+            return data[entityIdToIndex[entityId]];
+        }
+
+        unsigned int GetVersion(int entityId) const {
+            assert(Has(entityId) && "Entity does not have a component of this type");
+            return versions[entityIdToIndex[entityId]];
+        }
+
+        void SetVersion(int entityId, unsigned int version) {
+            assert(Has(entityId) && "Entity does not have a component of this type");
+            versions[entityIdToIndex[entityId]] = version;
+        }
+
+        // Direct access to the packed arrays, for systems that want to walk them linearly
+        Container& GetData() { return data; }
+        unsigned int* GetVersions() { return versions.data(); }
+        const std::vector<int>& GetEntityIds() const override { return indexToEntityId; }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// StagedComponents
+////////////////////////////////////////////////////////////////////////////////
+// Components added during a frame wait here, under the command lock of the
+// registry, until the flush commits them. Staging is kept apart from the
+// pools so that a pool is only ever created by the flush, never while systems
+// read the pools without taking the lock. The staging area of a component
+// type also knows how to create its pool.
+////////////////////////////////////////////////////////////////////////////////
+class IStagedComponents {
+    public:
+        virtual ~IStagedComponents() = default;
+        virtual std::shared_ptr<IPool> CreatePool() const = 0;
+        virtual void RegisterComponent(ArchetypeStorage& archetypeStorage, int componentId) const = 0;
+        virtual void Commit(IPool& pool, int entityId, int stagingIndex, unsigned int version) = 0;
+        virtual void* Get(int stagingIndex) = 0;
+        virtual void Clear() = 0;
+        virtual std::size_t GetMemoryUsage() const = 0;
+};
+
+template <typename T>
+class StagedComponents: public IStagedComponents {
+    private:
+        std::vector<T> data;
+
+    public:
+        // Keeps a component aside until the registry commits it, returns its staging index
+        int Stage(T object) {
+            data.push_back(std::move(object));
+            return static_cast<int>(data.size()) - 1;
+        }
+
+        std::shared_ptr<IPool> CreatePool() const override {
+            return std::make_shared<Pool<T>>();
+        }
+
+        void RegisterComponent(ArchetypeStorage& archetypeStorage, int componentId) const override {
+            archetypeStorage.RegisterComponent<T>(componentId);
+        }
+
+        void Commit(IPool& pool, int entityId, int stagingIndex, unsigned int version) override {
+            static_cast<Pool<T>&>(pool).Set(entityId, std::move(data[stagingIndex]), version);
+        }
+
+        void* Get(int stagingIndex) override {
+            return &data[stagingIndex];
+        }
+
+        void Clear() override {
+            data.clear();
+        }
+
+        std::size_t GetMemoryUsage() const override {
+            return data.capacity() * sizeof(T);
+        }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// ComponentView
+////////////////////////////////////////////////////////////////////////////////
+// A view visits every entity that owns all the given component types and hands
+// the components straight to a callback. It walks the dense entity array of the
+// smallest pool involved and checks the other pools with their O(1) sparse
+// lookup, so the cost is proportional to the rarest component of the query.
+// Components are passed as ComponentRef<T>, which is a plain T& unless the
+// component type uses a struct-of-arrays layout.
+// When the registry uses archetype storage, the view walks the chunks of the
+// matching archetypes instead, reading each component column linearly.
+// Tag components have no storage, so they are checked against the entity
+// signatures with a single bitset test. A view made only of tags scans the
+// signatures of all the entities.
+////////////////////////////////////////////////////////////////////////////////
+template <typename ...TComponents>
+class ComponentView {
+    private:
+        const class Registry* registry;
+        const ArchetypeStorage* archetypeStorage;
+        const std::vector<Signature>* entitySignatures;
+        std::tuple<Pool<TComponents>*...> pools;
+        const IPool* smallestPool = nullptr;
+
+        // Components that have storage, and tags that are only checked in the signatures
+        Signature requiredComponents;
+        Signature requiredTags;
+
+        static constexpr bool HAS_ONLY_TAGS = (IS_TAG_COMPONENT<TComponents> && ...);
+
+        template <typename T> bool HasComponentData(int entityId) const {
+            if constexpr (IS_TAG_COMPONENT<T>) {
+                return true;
+            } else {
+                return std::get<Pool<T>*>(pools)->Has(entityId);
+            }
+        }
+
+        template <typename T> ComponentRef<T> GetComponentData(int entityId) const {
+            if constexpr (IS_TAG_COMPONENT<T>) {
+                return T();
+            } else {
+                return std::get<Pool<T>*>(pools)->Get(entityId);
+            }
+        }
+
+        template <typename T> static T* GetColumn(const Archetype& archetype, ArchetypeChunk& chunk) {
+            if constexpr (IS_TAG_COMPONENT<T>) {
+                return nullptr;
+            } else {
+                return static_cast<T*>(archetype.GetColumn(chunk, Component<T>::GetId()));
+            }
+        }
+
+        template <typename T> static ComponentRef<T> GetColumnData(T* column, int row) {
+            if constexpr (IS_TAG_COMPONENT<T>) {
+                return T();
+            } else {
+                return ComponentLayout<T>::MakeReference(column[row]);
+            }
+        }
+
+        bool HasAllTags(int entityId) const {
+            return requiredTags.none() || (*entitySignatures)[entityId].Contains(requiredTags);
+        }
+
+        bool HasAllComponents(int entityId) const {
+            return HasAllTags(entityId) && (HasComponentData<TComponents>(entityId) && ...);
+        }
+
+        template <typename TFunc> void Visit(TFunc& func, int entityId, ComponentRef<TComponents> ...components) const;
+
+    public:
+        ComponentView(const class Registry* registry, const ArchetypeStorage* archetypeStorage, const std::vector<Signature>* entitySignatures, Pool<TComponents>* ...componentPools);
+
+        // Upper bound of the number of entities the view visits
+        int SizeHint() const;
+
+        // Calls func(entity, components...) or func(components...) for every matching entity
+        template <typename TFunc> void Each(TFunc&& func) const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// ComponentStorageMode
+////////////////////////////////////////////////////////////////////////////////
+// STORAGE_POOLS keeps one sparse-set pool per component type, which makes
+// adding and removing components cheap. STORAGE_ARCHETYPES packs the entities
+// that share a signature into chunks, which makes queries over entities with
+// many components in common faster at the cost of moving rows around when
+// their signature changes.
+////////////////////////////////////////////////////////////////////////////////
+enum ComponentStorageMode {
+    STORAGE_POOLS,
+    STORAGE_ARCHETYPES
 };
 
+////////////////////////////////////////////////////////////////////////////////
+// EntityCommand
+////////////////////////////////////////////////////////////////////////////////
+// Structural changes (creating/killing entities, adding/removing components)
+// are not applied right away. They are recorded as commands and executed in
+// order when the registry is flushed, so systems never see their entities or
+// pools change in the middle of an iteration.
+////////////////////////////////////////////////////////////////////////////////
+enum EntityCommandType {
+    COMMAND_CREATE_ENTITY,
+    COMMAND_KILL_ENTITY,
+    COMMAND_ADD_COMPONENT,
+    COMMAND_REMOVE_COMPONENT,
+    COMMAND_TAG_ENTITY,
+    COMMAND_REMOVE_TAG,
+    COMMAND_GROUP_ENTITY,
+    COMMAND_REMOVE_GROUP
+};
+
+struct EntityCommand {
+    EntityCommandType type;
+    Entity entity;
+    int componentId;
+    // Index of the staged component, or of the staged name for tag and group commands
+    int stagingIndex;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Registry
+////////////////////////////////////////////////////////////////////////////////
+// The registry manages the creation and destruction of entities, as well as
+// adding systems and adding components to entities.
+////////////////////////////////////////////////////////////////////////////////
 class Registry {
-    // TODO:...
+    private:
+        // Where the component data lives, chosen when the registry is created
+        ComponentStorageMode storageMode;
+
+        // Chunked component storage, only used with STORAGE_ARCHETYPES
+        ArchetypeStorage archetypeStorage;
+
+        // Bumped by every flush, and stamped on the components added or marked as changed since
+        unsigned int changeVersion = 1;
+
+        // Keep track of how many entity indices were handed out so far
+        std::atomic<int> numEntities{0};
+
+        // Serializes the structural changes requested by systems that run in parallel
+        mutable std::mutex commandMutex;
+
+        // Current generation of each entity index
+        // [vector index = entity id]
+        std::vector<int> entityGenerations;
+
+        // List of entity indices that were freed by killed entities, ready to be reused
+        std::deque<int> freeIds;
+
+        // Whether each entity index is sitting in freeIds. It is set by the flush and cleared by
+        // CreateEntity() while systems may be reading it, hence the atomics (in a deque, which
+        // can grow without moving them). [deque index = entity id]
+        std::deque<std::atomic<bool>> isIdFree;
+
+        // Array of component pools, each pool contains all the data for a certain component type.
+        // A pool is created by the flush that commits the first component of its type, so systems
+        // can read this array without the lock. (With STORAGE_ARCHETYPES the pools stay empty.)
+        // [array index = component type id]
+        std::array<std::shared_ptr<IPool>, MAX_COMPONENTS> componentPools;
+
+        // Components added since the last flush, guarded by commandMutex [array index = component type id]
+        std::array<std::unique_ptr<IStagedComponents>, MAX_COMPONENTS> stagedComponents;
+
+        // Vector of component signatures per entity, saying which component is turned "on" for a given entity
+        // [vector index = entity id]
+        std::vector<Signature> entityComponentSignatures;
+
+        // Map of active systems [index = system typeid]
+        std::unordered_map<std::type_index, std::shared_ptr<System>> systems;
+
+        // Structural changes recorded since the last registry Update(), in the order they were requested
+        std::vector<EntityCommand> pendingCommands;
+
+        // Entities whose signature changed during the flush and must be matched against the systems again
+        std::vector<Entity> entitiesToBeMatched;
+
+        // Flags the entities that are already in entitiesToBeMatched [vector index = entity id]
+        std::vector<bool> entityNeedsMatching;
+
+        // Entity tags (one tag name per entity)
+        std::unordered_map<std::string, Entity> entityPerTag;
+        std::unordered_map<int, std::string> tagPerEntity;
+
+        // Entity groups (one group per entity), each group keeps its entities packed in an array
+        std::unordered_map<std::string, std::vector<Entity>> entitiesPerGroup;
+        std::unordered_map<int, std::string> groupPerEntity;
+
+        // Slot of each entity in the array of its group [vector index = entity id]
+        std::vector<int> groupSlotPerEntity;
+
+        // Tag and group names waiting for the flush, referred to by the commands
+        std::vector<std::string> stagedNames;
+
+        int GetGenerationOf(int entityId) const;
+        bool IsIdFree(int entityId) const;
+
+        // A handle that is never alive, not even after indices are recycled, for lookups that found nothing
+        Entity GetInvalidEntity() const;
+
+        void ExecuteCommand(const EntityCommand& command);
+        void ApplyTag(Entity entity, const std::string& tag);
+        void EraseTag(int entityId);
+        void ApplyGroup(Entity entity, const std::string& group);
+        void EraseGroup(int entityId);
+        void FlagEntityForMatching(Entity entity);
+        void DestroyEntity(Entity entity);
+
+        // Adds or removes the entity from every system according to its current signature
+        void UpdateEntityInSystems(Entity entity);
+
+        // Remembers the pool revisions seen by the last AlignPools() of each pair of component types.
+        // Systems aligning different pairs may run in parallel, so the list has its own lock.
+        struct PoolAlignment {
+            int firstComponentId;
+            int secondComponentId;
+            unsigned int firstRevision;
+            unsigned int secondRevision;
+            int count;
+        };
+        std::vector<PoolAlignment> poolAlignments;
+        std::mutex poolAlignmentsMutex;
+
+    public:
+        Registry(ComponentStorageMode storageMode = STORAGE_POOLS): storageMode(storageMode) {};
+        ~Registry() = default;
+
+        ComponentStorageMode GetStorageMode() const { return storageMode; }
+
+        // The registry Update() flushes all the structural changes requested since the last call.
+        // Every entity touched by the flush is matched against the systems exactly once.
+        void Update();
+
+        // Entity management
+        Entity CreateEntity();
+        void KillEntity(Entity entity);
+        bool IsAlive(Entity entity) const;
+        int GetNumEntities() const;
+
+        // Returns the handle of the entity that currently owns the given index,
+        // or a handle that is never alive if the index is free
+        Entity GetEntityById(int entityId) const;
+
+        // Tag management. An entity has at most one tag and a tag names at most one entity.
+        // Like components, tags are applied by the next flush and dropped when the entity is killed.
+        void TagEntity(Entity entity, const std::string& tag);
+        bool EntityHasTag(Entity entity, const std::string& tag) const;
+        void RemoveEntityTag(Entity entity);
+
+        // Returns the entity with the tag in O(1), or a handle that is not alive if there is none
+        Entity GetEntityByTag(const std::string& tag) const;
+
+        // Group management. An entity belongs to at most one group, applied by the next flush.
+        void GroupEntity(Entity entity, const std::string& group);
+        bool EntityBelongsToGroup(Entity entity, const std::string& group) const;
+        void RemoveEntityGroup(Entity entity);
+
+        // Returns the packed array of the entities of a group, which stays valid until the next flush
+        const std::vector<Entity>& GetEntitiesByGroup(const std::string& group) const;
+
+        // Component management
+        template <typename TComponent, typename ...TArgs> void AddComponent(Entity entity, TArgs&& ...args);
+        template <typename TComponent> void RemoveComponent(Entity entity);
+        template <typename TComponent> bool HasComponent(Entity entity) const;
+        template <typename TComponent> ComponentRef<TComponent> GetComponent(Entity entity) const;
+
+        // Returns a view over the entities that own all the given component types
+        template <typename ...TComponents> ComponentView<TComponents...> View() const;
+
+        // Change tracking: adding a component stamps it with the current version, and systems that
+        // write a component in place call MarkChanged() on it. A reactive system remembers the
+        // version it last ran at and only visits the components changed since then:
+        //     unsigned int since = lastRunVersion;
+        //     lastRunVersion = registry->GetChangeVersion();
+        //     registry->EachChangedSince<TransformComponent>(since, func);
+        // Components changed during the whole frame of the last run are visited again, so that
+        // changes made by systems that ran after it in that frame are not missed.
+        unsigned int GetChangeVersion() const { return changeVersion; }
+        template <typename TComponent> void MarkChanged(Entity entity);
+
+        // Calls func(entity, component) for every component of the type changed at or after the given version
+        template <typename TComponent, typename TFunc> void EachChangedSince(unsigned int version, TFunc&& func);
+
+        // Changes whenever an entity gains or loses a component of the type, so systems can cache
+        // what they derive from the set of owners. With STORAGE_POOLS it also changes when the pool
+        // is reordered.
+        template <typename TComponent> unsigned int GetLayoutRevision() const;
+
+        // Direct access to the pool of a component type (nullptr until a flush commits the first one)
+        template <typename TComponent> std::shared_ptr<Pool<TComponent>> GetPool() const;
+
+        // Reorders the pools of two component types so that the entities owning both come first,
+        // in the same order in both pools, and returns how many they are. Slot i of one pool then
+        // belongs to the same entity as slot i of the other, so both can be streamed side by side.
+        // Only does work when one of the pools changed since the last call. Pool storage only.
+        // It moves data in both pools, so a system calling it must declare that it writes both
+        // component types, which keeps the scheduler from running it next to their readers.
+        template <typename TFirst, typename TSecond> int AlignPools();
+
+        // System management
+        template <typename TSystem, typename ...TArgs> void AddSystem(TArgs&& ...args);
+        template <typename TSystem> void RemoveSystem();
+        template <typename TSystem> bool HasSystem() const;
+        template <typename TSystem> TSystem& GetSystem() const;
+
+        // Removes the entity from every system it belongs to
+        void RemoveEntityFromSystems(Entity entity);
+
+        // Statistics for debugging tools. Counting the owners of a tag, or of any component with
+        // STORAGE_ARCHETYPES, walks all the entity signatures.
+        int GetNumComponents(int componentId) const;
+        std::size_t GetPoolMemoryUsage(int componentId) const;
+        std::size_t GetArchetypeMemoryUsage() const;
 };
 
 template <typename TComponent>
 void System::RequireComponent() {
-    const auto componentId = Component<TComponent>::GetId();
+    constexpr auto componentId = Component<TComponent>::GetId();
     componentSignature.set(componentId);
 }
 
+template <typename TComponent>
+void System::ReadsComponent() {
+    readSignature.set(Component<TComponent>::GetId());
+}
+
+template <typename TComponent>
+void System::WritesComponent() {
+    writeSignature.set(Component<TComponent>::GetId());
+}
+
+template <typename TComponent>
+std::shared_ptr<Pool<TComponent>> Registry::GetPool() const {
+    constexpr auto componentId = Component<TComponent>::GetId();
+    return std::static_pointer_cast<Pool<TComponent>>(componentPools[componentId]);
+}
+
+template <typename TComponent, typename ...TArgs>
+void Registry::AddComponent(Entity entity, TArgs&& ...args) {
+    if (!IsAlive(entity)) {
+        Logger::Err("Trying to add a component to an entity that is no longer alive.");
+        return;
+    }
+
+    constexpr auto componentId = Component<TComponent>::GetId();
+    std::lock_guard<std::mutex> lock(commandMutex);
+
+    // Tags have no data to keep, the flush only turns their bit on
+    if constexpr (IS_TAG_COMPONENT<TComponent>) {
+        static_assert(std::is_empty<TComponent>::value, "Tag components cannot have data members");
+        pendingCommands.push_back({COMMAND_ADD_COMPONENT, entity, componentId, -1});
+        return;
+    }
+
+    // The component waits in the staging area of its type until the next registry Update(),
+    // which also creates the pool if this is the first component of the type
+    if (!stagedComponents[componentId]) {
+        stagedComponents[componentId] = std::make_unique<StagedComponents<TComponent>>();
+    }
+    auto& staged = static_cast<StagedComponents<TComponent>&>(*stagedComponents[componentId]);
+    int stagingIndex = staged.Stage(TComponent(std::forward<TArgs>(args)...));
+
+    pendingCommands.push_back({COMMAND_ADD_COMPONENT, entity, componentId, stagingIndex});
+}
+
+template <typename TComponent>
+void Registry::RemoveComponent(Entity entity) {
+    if (!IsAlive(entity)) {
+        Logger::Err("Trying to remove a component from an entity that is no longer alive.");
+        return;
+    }
+
+    constexpr auto componentId = Component<TComponent>::GetId();
+    std::lock_guard<std::mutex> lock(commandMutex);
+    pendingCommands.push_back({COMMAND_REMOVE_COMPONENT, entity, componentId, -1});
+}
+
+template <typename TComponent>
+bool Registry::HasComponent(Entity entity) const {
+    if (!IsAlive(entity)) {
+        return false;
+    }
+    constexpr auto componentId = Component<TComponent>::GetId();
+    const auto entityId = entity.GetId();
+
+    // Entities created since the last flush have no components yet
+    if (entityId >= static_cast<int>(entityComponentSignatures.size())) {
+        return false;
+    }
+    return entityComponentSignatures[entityId].test(componentId);
+}
+
+template <typename TComponent>
+ComponentRef<TComponent> Registry::GetComponent(Entity entity) const {
+    static_assert(!IS_TAG_COMPONENT<TComponent>, "Tag components have no data, use HasComponent() instead");
+    assert(IsAlive(entity) && "GetComponent called with a stale entity handle");
+    if (storageMode == STORAGE_ARCHETYPES) {
+        TComponent* component = static_cast<TComponent*>(archetypeStorage.Get(entity.GetId(), Component<TComponent>::GetId()));
+        return ComponentLayout<TComponent>::MakeReference(*component);
+    }
+    return GetPool<TComponent>()->Get(entity.GetId());
+}
+
+template <typename TComponent>
+void Registry::MarkChanged(Entity entity) {
+    static_assert(!IS_TAG_COMPONENT<TComponent>, "Tag components have no data to change");
+    if (storageMode == STORAGE_ARCHETYPES) {
+        archetypeStorage.SetVersion(entity.GetId(), Component<TComponent>::GetId(), changeVersion);
+        return;
+    }
+    std::shared_ptr<Pool<TComponent>> componentPool = GetPool<TComponent>();
+    if (componentPool) {
+        componentPool->SetVersion(entity.GetId(), changeVersion);
+    }
+}
+
+template <typename TComponent, typename TFunc>
+void Registry::EachChangedSince(unsigned int version, TFunc&& func) {
+    static_assert(!IS_TAG_COMPONENT<TComponent>, "Tag components have no data to change");
+    std::shared_ptr<Pool<TComponent>> componentPool = GetPool<TComponent>();
+    if (!componentPool) {
+        return;
+    }
+    if (storageMode == STORAGE_ARCHETYPES) {
+        constexpr int componentId = Component<TComponent>::GetId();
+        Signature required;
+        required.set(componentId);
+        archetypeStorage.EachChunk(required, [&](const Archetype& archetype, ArchetypeChunk& chunk) {
+            const int* entityIds = archetype.GetEntityIds(chunk);
+            const unsigned int* versions = archetype.GetVersions(chunk, componentId);
+            TComponent* column = static_cast<TComponent*>(archetype.GetColumn(chunk, componentId));
+            for (int row = 0; row < chunk.count; row++) {
+                if (versions[row] >= version) {
+                    func(GetEntityById(entityIds[row]), ComponentLayout<TComponent>::MakeReference(column[row]));
+                }
+            }
+        });
+        return;
+    }
+    const unsigned int* versions = componentPool->GetVersions();
+    const std::vector<int>& entityIds = componentPool->GetEntityIds();
+    for (int index = 0; index < componentPool->GetSize(); index++) {
+        if (versions[index] >= version) {
+            func(GetEntityById(entityIds[index]), componentPool->GetData()[index]);
+        }
+    }
+}
+
+template <typename TComponent>
+unsigned int Registry::GetLayoutRevision() const {
+    static_assert(!IS_TAG_COMPONENT<TComponent>, "Tag components have no storage");
+    if (storageMode == STORAGE_ARCHETYPES) {
+        return archetypeStorage.GetStructuralRevision(Component<TComponent>::GetId());
+    }
+    std::shared_ptr<Pool<TComponent>> componentPool = GetPool<TComponent>();
+    return componentPool ? componentPool->GetLayoutRevision() : 0;
+}
+
+template <typename ...TComponents>
+ComponentView<TComponents...> Registry::View() const {
+    const ArchetypeStorage* archetypes = storageMode == STORAGE_ARCHETYPES ? &archetypeStorage : nullptr;
+    return ComponentView<TComponents...>(this, archetypes, &entityComponentSignatures, GetPool<TComponents>().get()...);
+}
+
+template <typename ...TComponents>
+ComponentView<TComponents...>::ComponentView(const Registry* registry, const ArchetypeStorage* archetypeStorage, const std::vector<Signature>* entitySignatures, Pool<TComponents>* ...componentPools):
+    registry(registry), archetypeStorage(archetypeStorage), entitySignatures(entitySignatures), pools(componentPools...) {
+    ((IS_TAG_COMPONENT<TComponents> ? requiredTags : requiredComponents).set(Component<TComponents>::GetId()), ...);
+
+    // If any of the component types with storage was never added there is nothing to visit
+    if (archetypeStorage || HAS_ONLY_TAGS || ((!IS_TAG_COMPONENT<TComponents> && componentPools == nullptr) || ...)) {
+        return;
+    }
+    for (const IPool* pool: {static_cast<const IPool*>(IS_TAG_COMPONENT<TComponents> ? nullptr : componentPools)...}) {
+        if (pool && (!smallestPool || pool->GetSize() < smallestPool->GetSize())) {
+            smallestPool = pool;
+        }
+    }
+}
+
+template <typename ...TComponents>
+int ComponentView<TComponents...>::SizeHint() const {
+    if (HAS_ONLY_TAGS) {
+        return static_cast<int>(entitySignatures->size());
+    }
+    if (archetypeStorage) {
+        int count = 0;
+        archetypeStorage->EachChunk(requiredComponents, [&count](const Archetype&, ArchetypeChunk& chunk) {
+            count += chunk.count;
+        });
+        return count;
+    }
+    return smallestPool ? smallestPool->GetSize() : 0;
+}
+
+template <typename ...TComponents>
+template <typename TFunc>
+void ComponentView<TComponents...>::Visit(TFunc& func, int entityId, ComponentRef<TComponents> ...components) const {
+    if constexpr (std::is_invocable_v<TFunc, Entity, ComponentRef<TComponents>...>) {
+        func(registry->GetEntityById(entityId), components...);
+    } else {
+        func(components...);
+    }
+}
+
+template <typename ...TComponents>
+template <typename TFunc>
+void ComponentView<TComponents...>::Each(TFunc&& func) const {
+    if constexpr (HAS_ONLY_TAGS) {
+        // Dead entities have an empty signature, so they never match
+        for (int entityId = 0; entityId < static_cast<int>(entitySignatures->size()); entityId++) {
+            if ((*entitySignatures)[entityId].Contains(requiredTags)) {
+                Visit(func, entityId, TComponents()...);
+            }
+        }
+        return;
+    }
+    if (archetypeStorage) {
+        archetypeStorage->EachChunk(requiredComponents, [&](const Archetype& archetype, ArchetypeChunk& chunk) {
+            const int* entityIds = archetype.GetEntityIds(chunk);
+            std::tuple<TComponents*...> columns(GetColumn<TComponents>(archetype, chunk)...);
+            for (int row = 0; row < chunk.count; row++) {
+                if (!HasAllTags(entityIds[row])) {
+                    continue;
+                }
+                Visit(func, entityIds[row], GetColumnData<TComponents>(std::get<TComponents*>(columns), row)...);
+            }
+        });
+        return;
+    }
+    if (!smallestPool) {
+        return;
+    }
+    for (int entityId: smallestPool->GetEntityIds()) {
+        if (!HasAllComponents(entityId)) {
+            continue;
+        }
+        Visit(func, entityId, GetComponentData<TComponents>(entityId)...);
+    }
+}
+
+template <typename TFirst, typename TSecond>
+int Registry::AlignPools() {
+    constexpr int firstComponentId = Component<TFirst>::GetId();
+    constexpr int secondComponentId = Component<TSecond>::GetId();
+    std::shared_ptr<Pool<TFirst>> firstPool = GetPool<TFirst>();
+    std::shared_ptr<Pool<TSecond>> secondPool = GetPool<TSecond>();
+    if (storageMode != STORAGE_POOLS || !firstPool || !secondPool) {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(poolAlignmentsMutex);
+    PoolAlignment* alignment = nullptr;
+    for (auto& existing: poolAlignments) {
+        if (existing.firstComponentId == firstComponentId && existing.secondComponentId == secondComponentId) {
+            alignment = &existing;
+        }
+    }
+    if (alignment &&
+        alignment->firstRevision == firstPool->GetLayoutRevision() &&
+        alignment->secondRevision == secondPool->GetLayoutRevision()) {
+        return alignment->count;
+    }
+
+    // Walk the first pool and move every entity that also owns a TSecond to the front of both pools
+    int count = 0;
+    const std::vector<int>& firstEntityIds = firstPool->GetEntityIds();
+    for (int index = 0; index < firstPool->GetSize(); index++) {
+        int entityId = firstEntityIds[index];
+        if (secondPool->Has(entityId)) {
+            firstPool->SwapSlots(index, count);
+            secondPool->SwapSlots(secondPool->GetIndexOf(entityId), count);
+            count++;
+        }
+    }
+
+    if (!alignment) {
+        poolAlignments.push_back({firstComponentId, secondComponentId, 0, 0, 0});
+        alignment = &poolAlignments.back();
+    }
+    alignment->firstRevision = firstPool->GetLayoutRevision();
+    alignment->secondRevision = secondPool->GetLayoutRevision();
+    alignment->count = count;
+    return count;
+}
+
+template <typename TSystem, typename ...TArgs>
+void Registry::AddSystem(TArgs&& ...args) {
+    std::shared_ptr<TSystem> newSystem = std::make_shared<TSystem>(std::forward<TArgs>(args)...);
+    newSystem->registry = this;
+    systems.insert(std::make_pair(std::type_index(typeid(TSystem)), newSystem));
+}
+
+template <typename TSystem>
+void Registry::RemoveSystem() {
+    systems.erase(std::type_index(typeid(TSystem)));
+}
+
+template <typename TSystem>
+bool Registry::HasSystem() const {
+    return systems.find(std::type_index(typeid(TSystem))) != systems.end();
+}
+
+template <typename TSystem>
+TSystem& Registry::GetSystem() const {
+    auto system = systems.find(std::type_index(typeid(TSystem)));
+    return *(std::static_pointer_cast<TSystem>(system->second));
+}
+
+template <typename TComponent, typename ...TArgs>
+void Entity::AddComponent(TArgs&& ...args) {
+    registry->AddComponent<TComponent>(*this, std::forward<TArgs>(args)...);
+}
+
+template <typename TComponent>
+void Entity::RemoveComponent() {
+    registry->RemoveComponent<TComponent>(*this);
+}
+
+template <typename TComponent>
+bool Entity::HasComponent() const {
+    return registry->HasComponent<TComponent>(*this);
+}
+
+template <typename TComponent>
+ComponentRef<TComponent> Entity::GetComponent() const {
+    return registry->GetComponent<TComponent>(*this);
+}
+
 #endif
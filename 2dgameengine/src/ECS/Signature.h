@@ -0,0 +1,149 @@
+#ifndef SIGNATURE_H
+#define SIGNATURE_H
+
+#include <cstddef>
+#include <cstdint>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// Number of component types a signature can hold. Override it at build time
+// with -DECS_MAX_COMPONENTS=256 (it must be a multiple of 128).
+#ifndef ECS_MAX_COMPONENTS
+#define ECS_MAX_COMPONENTS 128
+#endif
+
+const unsigned int MAX_COMPONENTS = ECS_MAX_COMPONENTS;
+
+static_assert(MAX_COMPONENTS > 0 && MAX_COMPONENTS % 128 == 0, "MAX_COMPONENTS must be a multiple of 128");
+
+////////////////////////////////////////////////////////////////////////////////
+// Signature
+////////////////////////////////////////////////////////////////////////////////
+// We use a bitset (1s and 0s) to keep track of which components an entity has,
+// and also helps keep track of which entities a system is interested in.
+// The bits are stored in 64-bit words so that checking whether an entity has
+// everything a system requires is a handful of 128/256-bit vector operations.
+////////////////////////////////////////////////////////////////////////////////
+class Signature {
+    private:
+        static constexpr unsigned int NUM_WORDS = MAX_COMPONENTS / 64;
+        alignas(32) std::uint64_t words[NUM_WORDS] = {};
+
+    public:
+        Signature& set(std::size_t position) {
+            words[position / 64] |= std::uint64_t(1) << (position % 64);
+            return *this;
+        }
+
+        Signature& reset(std::size_t position) {
+            words[position / 64] &= ~(std::uint64_t(1) << (position % 64));
+            return *this;
+        }
+
+        Signature& reset() {
+            for (auto& word: words) {
+                word = 0;
+            }
+            return *this;
+        }
+
+        bool test(std::size_t position) const {
+            return (words[position / 64] >> (position % 64)) & 1;
+        }
+
+        bool none() const {
+            for (auto word: words) {
+                if (word != 0) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        bool any() const {
+            return !none();
+        }
+
+        // Returns true if every bit that is set in other is also set in this signature
+        bool Contains(const Signature& other) const;
+
+        // Calls func with the position of every set bit, in increasing order
+        template <typename TFunc>
+        void ForEachSetBit(TFunc&& func) const {
+            for (unsigned int i = 0; i < NUM_WORDS; i++) {
+                for (std::uint64_t word = words[i]; word != 0; word &= word - 1) {
+                    func(static_cast<std::size_t>(i * 64 + __builtin_ctzll(word)));
+                }
+            }
+        }
+
+        Signature operator &(const Signature& other) const {
+            Signature result;
+            for (unsigned int i = 0; i < NUM_WORDS; i++) {
+                result.words[i] = words[i] & other.words[i];
+            }
+            return result;
+        }
+
+        Signature operator |(const Signature& other) const {
+            Signature result;
+            for (unsigned int i = 0; i < NUM_WORDS; i++) {
+                result.words[i] = words[i] | other.words[i];
+            }
+            return result;
+        }
+
+        bool operator ==(const Signature& other) const {
+            for (unsigned int i = 0; i < NUM_WORDS; i++) {
+                if (words[i] != other.words[i]) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        bool operator !=(const Signature& other) const {
+            return !(*this == other);
+        }
+};
+
+inline bool Signature::Contains(const Signature& other) const {
+    unsigned int i = 0;
+#if defined(__AVX__)
+    // vptest sets the carry flag when (~a & b) == 0, i.e. when b is a subset of a
+    for (; i + 4 <= NUM_WORDS; i += 4) {
+        __m256i a = _mm256_load_si256(reinterpret_cast<const __m256i*>(&words[i]));
+        __m256i b = _mm256_load_si256(reinterpret_cast<const __m256i*>(&other.words[i]));
+        if (!_mm256_testc_si256(a, b)) {
+            return false;
+        }
+    }
+#endif
+#if defined(__SSE4_1__)
+    for (; i + 2 <= NUM_WORDS; i += 2) {
+        __m128i a = _mm_load_si128(reinterpret_cast<const __m128i*>(&words[i]));
+        __m128i b = _mm_load_si128(reinterpret_cast<const __m128i*>(&other.words[i]));
+        if (!_mm_testc_si128(a, b)) {
+            return false;
+        }
+    }
+#elif defined(__SSE2__)
+    // Without ptest, compare (a & b) with b byte by byte
+    for (; i + 2 <= NUM_WORDS; i += 2) {
+        __m128i a = _mm_load_si128(reinterpret_cast<const __m128i*>(&words[i]));
+        __m128i b = _mm_load_si128(reinterpret_cast<const __m128i*>(&other.words[i]));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(a, b), b)) != 0xFFFF) {
+            return false;
+        }
+    }
+#endif
+    for (; i < NUM_WORDS; i++) {
+        if ((words[i] & other.words[i]) != other.words[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#endif
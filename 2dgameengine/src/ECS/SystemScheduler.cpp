@@ -0,0 +1,73 @@
+#include "SystemScheduler.h"
+#include "../Profiler/Profiler.h"
+#include <algorithm>
+
+SystemScheduler::SystemScheduler(JobSystem& jobSystem): jobSystem(jobSystem) {
+}
+
+void SystemScheduler::AddSystem(System& system) {
+    SystemNode node;
+    node.system = &system;
+    nodes.push_back(node);
+}
+
+void SystemScheduler::RemoveSystem(System& system) {
+    nodes.erase(
+        std::remove_if(nodes.begin(), nodes.end(), [&system](const SystemNode& node) { return node.system == &system; }),
+        nodes.end()
+    );
+}
+
+void SystemScheduler::BuildGraph() {
+    for (auto& node: nodes) {
+        node.dependents.clear();
+        node.numDependencies = 0;
+    }
+    // Only edges from earlier to later systems, so the graph can't have cycles
+    for (int i = 0; i < static_cast<int>(nodes.size()); i++) {
+        for (int j = i + 1; j < static_cast<int>(nodes.size()); j++) {
+            if (nodes[i].system->ConflictsWith(*nodes[j].system)) {
+                nodes[i].dependents.push_back(j);
+                nodes[j].numDependencies++;
+            }
+        }
+    }
+    remainingDependencies.reset(new std::atomic<int>[nodes.size()]);
+    for (int i = 0; i < static_cast<int>(nodes.size()); i++) {
+        remainingDependencies[i] = nodes[i].numDependencies;
+    }
+}
+
+void SystemScheduler::RunSystem(int nodeIndex) {
+    {
+        PROFILE_SCOPE(nodes[nodeIndex].system->GetName());
+        nodes[nodeIndex].system->Update(frameDeltaTime);
+    }
+
+    // The last dependency to finish hands the dependent system over to the job system
+    for (int dependent: nodes[nodeIndex].dependents) {
+        if (remainingDependencies[dependent].fetch_sub(1) == 1) {
+            jobSystem.Run([this, dependent] { RunSystem(dependent); }, &runningSystems);
+        }
+    }
+}
+
+void SystemScheduler::Run(double deltaTime) {
+    if (nodes.empty()) {
+        return;
+    }
+    PROFILE_SCOPE("SystemScheduler::Run");
+    frameDeltaTime = deltaTime;
+    BuildGraph();
+
+    for (int i = 0; i < static_cast<int>(nodes.size()); i++) {
+        if (nodes[i].numDependencies == 0) {
+            jobSystem.Run([this, i] { RunSystem(i); }, &runningSystems);
+        }
+    }
+
+    // A dependent system is queued before the system it waited for is counted as done,
+    // so the counter only drops to zero once the whole graph has run. Only the systems and the
+    // batches of their ParallelFor loops are queued meanwhile, so those are all this thread runs.
+    jobSystem.Wait(runningSystems);
+}
@@ -0,0 +1,49 @@
+#ifndef SYSTEMSCHEDULER_H
+#define SYSTEMSCHEDULER_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "ECS.h"
+#include "../Jobs/JobSystem.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// SystemScheduler
+////////////////////////////////////////////////////////////////////////////////
+// Runs the Update() of a list of systems on the job system. Every frame it
+// builds a dependency graph out of the components each system declared to
+// read and write: a system waits for the systems added before it that it
+// conflicts with, and everything else runs at the same time. Two systems
+// that write the same component keep the order in which they were added.
+////////////////////////////////////////////////////////////////////////////////
+class SystemScheduler {
+    private:
+        struct SystemNode {
+            System* system = nullptr;
+            std::vector<int> dependents;
+            int numDependencies = 0;
+        };
+
+        JobSystem& jobSystem;
+        std::vector<SystemNode> nodes;
+
+        // Per-frame state of the running graph
+        std::unique_ptr<std::atomic<int>[]> remainingDependencies;
+        JobCounter runningSystems;
+        double frameDeltaTime = 0.0;
+
+        void BuildGraph();
+        void RunSystem(int nodeIndex);
+
+    public:
+        SystemScheduler(JobSystem& jobSystem);
+
+        // Systems are scheduled in the order they are added when their accesses conflict
+        void AddSystem(System& system);
+        void RemoveSystem(System& system);
+
+        // Runs all the systems once and returns when they are all done
+        void Run(double deltaTime);
+};
+
+#endif
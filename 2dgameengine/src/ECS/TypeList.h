@@ -0,0 +1,36 @@
+#ifndef TYPELIST_H
+#define TYPELIST_H
+
+#include <type_traits>
+
+////////////////////////////////////////////////////////////////////////////////
+// TypeList
+////////////////////////////////////////////////////////////////////////////////
+// A compile-time list of types. TypeIndex<T, TList>::value is the position of
+// T in the list, and fails to compile if T is not part of it.
+////////////////////////////////////////////////////////////////////////////////
+template <typename ...Ts>
+struct TypeList {
+    static constexpr int size = sizeof...(Ts);
+};
+
+template <typename T, typename TList>
+struct TypeIndex;
+
+template <typename T>
+struct TypeIndex<T, TypeList<>> {
+    static_assert(!std::is_same<T, T>::value, "Type is not part of the type list");
+    static constexpr int value = -1;
+};
+
+template <typename T, typename ...Ts>
+struct TypeIndex<T, TypeList<T, Ts...>> {
+    static constexpr int value = 0;
+};
+
+template <typename T, typename THead, typename ...Ts>
+struct TypeIndex<T, TypeList<THead, Ts...>> {
+    static constexpr int value = 1 + TypeIndex<T, TypeList<Ts...>>::value;
+};
+
+#endif
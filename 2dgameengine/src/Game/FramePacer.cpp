@@ -0,0 +1,144 @@
+#include "FramePacer.h"
+#include <algorithm>
+#include <cmath>
+
+FramePacer::FramePacer(FramePacingMode mode, int targetFps): mode(mode) {
+    frequency = SDL_GetPerformanceFrequency();
+    targetFrameTime = 1.0 / std::max(1, targetFps);
+    frameTimes.reserve(NUM_SAMPLES);
+    Reset();
+}
+
+FramePacingMode FramePacer::GetMode() const {
+    return mode;
+}
+
+void FramePacer::SetMode(FramePacingMode mode) {
+    this->mode = mode;
+    nextFrameDeadline = previousFrameCounter;
+}
+
+void FramePacer::SetTargetFps(int fps) {
+    targetFrameTime = 1.0 / std::max(1, fps);
+    nextFrameDeadline = previousFrameCounter;
+}
+
+double FramePacer::GetTargetFrameTime() const {
+    return targetFrameTime;
+}
+
+void FramePacer::Reset() {
+    previousFrameCounter = SDL_GetPerformanceCounter();
+    nextFrameDeadline = previousFrameCounter;
+    frameTimes.clear();
+    nextSample = 0;
+}
+
+double FramePacer::CountsToSeconds(Uint64 counts) const {
+    return static_cast<double>(counts) / frequency;
+}
+
+void FramePacer::WaitUntil(Uint64 deadline) const {
+    const Uint64 spinMargin = static_cast<Uint64>(SPIN_MARGIN * frequency);
+    Uint64 now = SDL_GetPerformanceCounter();
+
+    // Sleep in small steps while we are far enough from the deadline not to oversleep past it
+    while (now + spinMargin < deadline) {
+        SDL_Delay(1);
+        now = SDL_GetPerformanceCounter();
+    }
+    // Busy wait for the rest, the counter is much more precise than the scheduler
+    while (now < deadline) {
+        now = SDL_GetPerformanceCounter();
+    }
+}
+
+double FramePacer::WaitForNextFrame() {
+    if (mode == PACING_CAPPED) {
+        const Uint64 targetCounts = static_cast<Uint64>(targetFrameTime * frequency);
+        nextFrameDeadline += targetCounts;
+
+        // More than a frame late: start over from now instead of rushing frames to catch up
+        Uint64 now = SDL_GetPerformanceCounter();
+        if (now > nextFrameDeadline + targetCounts) {
+            nextFrameDeadline = now;
+        }
+        WaitUntil(nextFrameDeadline);
+    }
+
+    Uint64 currentFrameCounter = SDL_GetPerformanceCounter();
+    double frameTime = CountsToSeconds(currentFrameCounter - previousFrameCounter);
+    previousFrameCounter = currentFrameCounter;
+    if (mode != PACING_CAPPED) {
+        nextFrameDeadline = currentFrameCounter;
+    }
+
+    if (static_cast<int>(frameTimes.size()) < NUM_SAMPLES) {
+        frameTimes.push_back(frameTime);
+    } else {
+        frameTimes[nextSample] = frameTime;
+    }
+    nextSample = (nextSample + 1) % NUM_SAMPLES;
+
+    return frameTime;
+}
+
+double FramePacer::GetLastFrameTime() const {
+    if (frameTimes.empty()) {
+        return 0.0;
+    }
+    return frameTimes[(nextSample + NUM_SAMPLES - 1) % NUM_SAMPLES];
+}
+
+std::vector<float> FramePacer::GetFrameTimeHistory() const {
+    std::vector<float> history;
+    history.reserve(frameTimes.size());
+    // Until the buffer is full, the oldest frame is at index 0
+    int oldest = static_cast<int>(frameTimes.size()) < NUM_SAMPLES ? 0 : nextSample;
+    for (int i = 0; i < static_cast<int>(frameTimes.size()); i++) {
+        history.push_back(static_cast<float>(frameTimes[(oldest + i) % NUM_SAMPLES] * 1000.0));
+    }
+    return history;
+}
+
+FrameTimingStats FramePacer::GetStats() const {
+    FrameTimingStats stats;
+    stats.targetFrameTime = targetFrameTime;
+    stats.numFrames = static_cast<int>(frameTimes.size());
+    if (frameTimes.empty()) {
+        return stats;
+    }
+
+    stats.minFrameTime = frameTimes[0];
+    stats.maxFrameTime = frameTimes[0];
+    double sum = 0.0;
+    for (double frameTime: frameTimes) {
+        sum += frameTime;
+        stats.minFrameTime = std::min(stats.minFrameTime, frameTime);
+        stats.maxFrameTime = std::max(stats.maxFrameTime, frameTime);
+        if (mode != PACING_UNCAPPED && frameTime > targetFrameTime * 1.5) {
+            stats.numMissedFrames++;
+        }
+    }
+    stats.averageFrameTime = sum / stats.numFrames;
+
+    // Uncapped frames have no target to deviate from, so they are measured against their average
+    double expectedFrameTime = mode == PACING_UNCAPPED ? stats.averageFrameTime : targetFrameTime;
+    double sumSquares = 0.0;
+    for (double frameTime: frameTimes) {
+        double deviation = frameTime - stats.averageFrameTime;
+        sumSquares += deviation * deviation;
+        stats.maxJitter = std::max(stats.maxJitter, std::abs(frameTime - expectedFrameTime));
+    }
+    stats.jitter = std::sqrt(sumSquares / stats.numFrames);
+    return stats;
+}
+
+const char* FramePacer::GetModeName(FramePacingMode mode) {
+    switch (mode) {
+        case PACING_CAPPED: return "capped";
+        case PACING_UNCAPPED: return "uncapped";
+        case PACING_VSYNC: return "vsync";
+    }
+    return "unknown";
+}
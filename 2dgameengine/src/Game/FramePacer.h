@@ -0,0 +1,85 @@
+#ifndef FRAMEPACER_H
+#define FRAMEPACER_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+enum FramePacingMode {
+    PACING_CAPPED,
+    PACING_UNCAPPED,
+    PACING_VSYNC
+};
+
+// Frame times of the recent frames, in seconds
+struct FrameTimingStats {
+    int numFrames = 0;
+    double targetFrameTime = 0.0;
+    double averageFrameTime = 0.0;
+    double minFrameTime = 0.0;
+    double maxFrameTime = 0.0;
+    // Standard deviation of the frame time, and worst distance from the target
+    double jitter = 0.0;
+    double maxJitter = 0.0;
+    // Frames that took more than one and a half times the target
+    int numMissedFrames = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// FramePacer
+////////////////////////////////////////////////////////////////////////////////
+// Paces the game loop with the high resolution performance counter. In the
+// capped mode it waits until the deadline of the next frame by sleeping in
+// 1 ms steps, then spins for the last stretch, because SDL_Delay can wake up
+// a couple of milliseconds late. Deadlines are absolute, so an early or late
+// frame doesn't shift the following ones. In the vsync mode the renderer
+// blocks on present and the pacer only measures; in the uncapped mode it
+// doesn't wait at all.
+////////////////////////////////////////////////////////////////////////////////
+class FramePacer {
+    private:
+        // How many frames the stats are computed over
+        static constexpr int NUM_SAMPLES = 240;
+
+        // Time left before the deadline below which we spin instead of sleeping
+        static constexpr double SPIN_MARGIN = 0.002;
+
+        FramePacingMode mode;
+        double targetFrameTime;
+
+        Uint64 frequency;
+        Uint64 previousFrameCounter = 0;
+        Uint64 nextFrameDeadline = 0;
+
+        // Circular buffer of the last frame times
+        std::vector<double> frameTimes;
+        int nextSample = 0;
+
+        double CountsToSeconds(Uint64 counts) const;
+        void WaitUntil(Uint64 deadline) const;
+
+    public:
+        FramePacer(FramePacingMode mode = PACING_CAPPED, int targetFps = 60);
+
+        FramePacingMode GetMode() const;
+        void SetMode(FramePacingMode mode);
+
+        // In the vsync mode, the target is only used to tell missed frames apart
+        void SetTargetFps(int fps);
+        double GetTargetFrameTime() const;
+
+        // Starts measuring from now, e.g. after a long loading screen
+        void Reset();
+
+        // Waits for the next frame according to the mode, returns the time since the last one in seconds
+        double WaitForNextFrame();
+
+        double GetLastFrameTime() const;
+        FrameTimingStats GetStats() const;
+
+        // The recent frame times in milliseconds, oldest first
+        std::vector<float> GetFrameTimeHistory() const;
+
+        static const char* GetModeName(FramePacingMode mode);
+};
+
+#endif
@@ -1,13 +1,28 @@
 #include "Game.h"
 #include "../Logger/Logger.h"
+#include "../Profiler/Profiler.h"
 #include "../ECS/ECS.h"
+#include "../Components/TransformComponent.h"
+#include "../Components/RigidBodyComponent.h"
+#include "../Components/HierarchyComponent.h"
+#include "../Components/SpriteComponent.h"
+#include "../Components/InterpolationComponent.h"
+#include "../Systems/MovementSystem.h"
+#include "../Systems/HierarchySystem.h"
+#include "../Systems/InterpolationSystem.h"
+#include "../Systems/RenderSystem.h"
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 #include <glm/glm.hpp>
+#include <algorithm>
+#include <ctime>
 #include <iostream>
 
-Game::Game() {
+Game::Game(): framePacer(PACING_CAPPED, FPS) {
     isRunning = false;
+    registry = std::make_unique<Registry>();
+    jobSystem = std::make_unique<JobSystem>();
+    systemScheduler = std::make_unique<SystemScheduler>(*jobSystem);
     Logger::Log("Game constructor called!");
 }
 
@@ -16,6 +31,18 @@ Game::~Game() {
 }
 
 void Game::Initialize() {
+    if (isHeadless) {
+        // The dummy video driver works without a display, and SDL still turns Ctrl+C into SDL_QUIT
+        SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+        if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER | SDL_INIT_EVENTS) != 0) {
+            Logger::Err("Error initializing SDL.");
+            return;
+        }
+        framePacer.SetMode(PACING_UNCAPPED);
+        Logger::Log("Running headless.");
+        isRunning = true;
+        return;
+    }
     if (SDL_Init(SDL_INIT_EVERYTHING) != 0) {
         Logger::Err("Error initializing SDL.");
         return;
@@ -36,18 +63,31 @@ void Game::Initialize() {
         Logger::Err("Error creating SDL window.");
         return;
     }
-    renderer = SDL_CreateRenderer(window, -1, 0);
+    Uint32 rendererFlags = 0;
+    if (framePacer.GetMode() == PACING_VSYNC) {
+        // Present blocks until the vertical blank, the pacer only needs the refresh rate to spot missed frames
+        rendererFlags |= SDL_RENDERER_PRESENTVSYNC;
+        if (displayMode.refresh_rate > 0) {
+            framePacer.SetTargetFps(displayMode.refresh_rate);
+        }
+    }
+    renderer = SDL_CreateRenderer(window, -1, rendererFlags);
     if (!renderer) {
         Logger::Err("Error creating SDL renderer.");
         return;
     }
     SDL_SetWindowFullscreen(window, SDL_WINDOW_FULLSCREEN);
+
+    // Toggled with F1
+    performanceOverlay.Initialize(renderer, windowWidth, windowHeight);
     isRunning = true;
 }
 
 void Game::ProcessInput() {
+    PROFILE_SCOPE("ProcessInput");
     SDL_Event sdlEvent;
     while (SDL_PollEvent(&sdlEvent)) {
+        performanceOverlay.ProcessEvent(sdlEvent);
         switch (sdlEvent.type) {
             case SDL_QUIT:
                 isRunning = false;
@@ -56,58 +96,242 @@ void Game::ProcessInput() {
                 if (sdlEvent.key.keysym.sym == SDLK_ESCAPE) {
                     isRunning = false;
                 }
+                if (sdlEvent.key.keysym.sym == SDLK_F1) {
+                    performanceOverlay.Toggle();
+                }
+                if (sdlEvent.key.keysym.sym == SDLK_F9 && !Profiler::IsCapturingTrace()) {
+                    StartTraceCapture(TRACE_CAPTURE_FRAMES);
+                }
                 break;
         }
     }
 }
 
 void Game::Setup() {
+    // Add the systems that need to be processed in our game
+    registry->AddSystem<InterpolationSystem>();
+    registry->AddSystem<MovementSystem>(jobSystem.get());
+    registry->AddSystem<HierarchySystem>(jobSystem.get());
+    registry->AddSystem<RenderSystem>();
+
+    // The simulation systems run on every fixed step, in this order when they share data
+    systemScheduler->AddSystem(registry->GetSystem<InterpolationSystem>());
+    systemScheduler->AddSystem(registry->GetSystem<MovementSystem>());
+    systemScheduler->AddSystem(registry->GetSystem<HierarchySystem>());
+    Logger::Log("Movement kernel: " + std::string(MovementKernels::GetKernelName()));
+
+    Entity tank = registry->CreateEntity();
+    tank.AddComponent<TransformComponent>(glm::vec2(10.0, 30.0), glm::vec2(1.0, 1.0), 0.0);
+    tank.AddComponent<RigidBodyComponent>(glm::vec2(50.0, 0.0));
+    tank.AddComponent<SpriteComponent>(10, 10);
+    tank.AddComponent<InterpolationComponent>();
+
+    // The turret follows the tank, its world transform is computed by the HierarchySystem
+    Entity turret = registry->CreateEntity();
+    turret.AddComponent<TransformComponent>();
+    turret.AddComponent<HierarchyComponent>(tank, glm::vec2(8.0, 0.0));
+    turret.AddComponent<SpriteComponent>(4, 4);
+    turret.AddComponent<InterpolationComponent>();
+
     // TODO:
-    // Entity tank = registry.CreateEntity();
-    // tank.AddComponent<TransformComponent>();
     // tank.AddComponent<BoxColliderComponent>();
     // tank.AddComponent<SpriteComponent>("./assets/images/tank.png");
 }
 
 void Game::Update() {
-    // If we are too fast, waste some time until we reach the MILLISECS_PER_FRAME
-    int timeToWait = MILLISECS_PER_FRAME - (SDL_GetTicks() - millisecsPreviousFrame);
-    if (timeToWait > 0 && timeToWait <= MILLISECS_PER_FRAME) {
-        SDL_Delay(timeToWait);
+    PROFILE_SCOPE("Update");
+
+    // If we are too fast, wait until the next frame is due, and get the time since the last one in seconds
+    double deltaTime;
+    {
+        PROFILE_SCOPE("WaitForNextFrame");
+        deltaTime = framePacer.WaitForNextFrame();
     }
 
-    // The difference in ticks since the last frame, converted to seconds
-    double deltaTime = (SDL_GetTicks() - millisecsPreviousFrame) / 1000.0;
+    // Without anyone watching, there is no real time to keep up with
+    if (isHeadless) {
+        FixedUpdate(fixedDeltaTime);
+        return;
+    }
 
-    // Store the "previous" frame time
-    millisecsPreviousFrame = SDL_GetTicks();
-    
-    // TODO:
-    // MovementSystem.Update();
-    // CollisionSystem.Update();
-    // DamageSystem.Update();
+    // Run as many fixed steps as needed to catch up with the time that passed
+    accumulator += deltaTime;
+    int numSteps = 0;
+    while (accumulator >= fixedDeltaTime && numSteps < MAX_SIMULATION_STEPS_PER_FRAME) {
+        FixedUpdate(fixedDeltaTime);
+        accumulator -= fixedDeltaTime;
+        numSteps++;
+    }
+
+    // If the simulation can't keep up, let it fall behind real time instead of spiraling
+    if (accumulator >= fixedDeltaTime) {
+        accumulator = 0.0;
+    }
+
+    interpolationAlpha = accumulator / fixedDeltaTime;
+}
+
+void Game::FixedUpdate(double deltaTime) {
+    PROFILE_SCOPE("FixedUpdate");
+
+    // Flush the structural changes (entities created/killed, components added/removed) requested
+    // since the last flush. Call it again between system phases that depend on each other's changes.
+    {
+        PROFILE_SCOPE("Registry::Update");
+        registry->Update();
+    }
+
+    // Invoke all the systems that need to update, the ones that don't share data run in parallel
+    systemScheduler->Run(deltaTime);
+}
+
+void Game::SetSimulationRate(int hz) {
+    if (hz <= 0) {
+        Logger::Err("Invalid simulation rate: " + std::to_string(hz) + " Hz.");
+        return;
+    }
+    fixedDeltaTime = 1.0 / hz;
+}
+
+void Game::SetFramePacingMode(FramePacingMode mode) {
+    framePacer.SetMode(mode);
+}
+
+void Game::SetHeadless(bool isHeadless) {
+    this->isHeadless = isHeadless;
+}
+
+void Game::SetRunLimit(int maxFrames, double maxDuration) {
+    this->maxFrames = std::max(0, maxFrames);
+    this->maxDuration = std::max(0.0, maxDuration);
+}
+
+void Game::StartTraceCapture(int numFrames) {
+    char fileName[64];
+    std::time_t now = std::time(nullptr);
+    std::strftime(fileName, sizeof(fileName), "./trace-%Y%m%d-%H%M%S.json", std::localtime(&now));
+    Profiler::StartTraceCapture(fileName, numFrames);
+}
+
+bool Game::HasReachedRunLimit() const {
+    if (maxFrames > 0 && numFrames >= maxFrames) {
+        return true;
+    }
+    if (maxDuration > 0.0) {
+        double elapsed = static_cast<double>(SDL_GetPerformanceCounter() - runStartCounter) / SDL_GetPerformanceFrequency();
+        return elapsed >= maxDuration;
+    }
+    return false;
 }
 
 void Game::Render() {
+    if (isHeadless) {
+        return;
+    }
+    PROFILE_SCOPE("Render");
     SDL_SetRenderDrawColor(renderer, 21, 21, 21, 255);
     SDL_RenderClear(renderer);
 
-    // TODO: Render game objects...
+    // Render all the entities in between the last two simulation steps
+    RenderSystem& renderSystem = registry->GetSystem<RenderSystem>();
+    {
+        PROFILE_SCOPE(renderSystem.GetName());
+        renderSystem.Update(renderer, interpolationAlpha);
+    }
+
+    // Drawn on top of the game
+    performanceOverlay.Render(*registry, framePacer, renderSystem.GetNumDrawCalls());
 
-    SDL_RenderPresent(renderer);
+    {
+        PROFILE_SCOPE("SDL_RenderPresent");
+        SDL_RenderPresent(renderer);
+    }
 }
 
 void Game::Run() {
     Setup();
+    // Don't count the time spent loading as the first frame
+    framePacer.Reset();
+    numFrames = 0;
+    runStartCounter = SDL_GetPerformanceCounter();
+    if (isHeadless) {
+        frameTimes.reserve(maxFrames > 0 ? std::min(maxFrames, MAX_RECORDED_FRAME_TIMES) : MAX_RECORDED_FRAME_TIMES);
+    }
     while (isRunning) {
+        Uint64 frameStartCounter = SDL_GetPerformanceCounter();
         ProcessInput();
         Update();
         Render();
+        Profiler::EndFrame();
+
+        if (isHeadless) {
+            double frameTime = static_cast<double>(SDL_GetPerformanceCounter() - frameStartCounter) / SDL_GetPerformanceFrequency();
+            if (static_cast<int>(frameTimes.size()) < MAX_RECORDED_FRAME_TIMES) {
+                frameTimes.push_back(frameTime);
+            } else {
+                frameTimes[numFrames % MAX_RECORDED_FRAME_TIMES] = frameTime;
+            }
+        }
+        numFrames++;
+        if (HasReachedRunLimit()) {
+            isRunning = false;
+        }
+    }
+    if (isHeadless) {
+        LogHeadlessSummary();
     }
 }
 
+void Game::LogHeadlessSummary() const {
+    double elapsed = static_cast<double>(SDL_GetPerformanceCounter() - runStartCounter) / SDL_GetPerformanceFrequency();
+    Logger::Log("Ran " + std::to_string(numFrames) + " frames in " + std::to_string(elapsed) + " s, " +
+        std::to_string(numFrames * fixedDeltaTime) + " s of simulated time.");
+    if (frameTimes.empty()) {
+        return;
+    }
+
+    std::vector<double> sortedFrameTimes(frameTimes);
+    std::sort(sortedFrameTimes.begin(), sortedFrameTimes.end());
+    double sum = 0.0;
+    for (double frameTime: sortedFrameTimes) {
+        sum += frameTime;
+    }
+    auto percentile = [&sortedFrameTimes](double p) {
+        size_t index = static_cast<size_t>(p * (sortedFrameTimes.size() - 1) + 0.5);
+        return sortedFrameTimes[index] * 1000.0;
+    };
+    double average = sum / sortedFrameTimes.size();
+    Logger::Log(
+        "Frame times over the last " + std::to_string(sortedFrameTimes.size()) + " frames: avg " +
+        std::to_string(average * 1000.0) + " ms (" + std::to_string(average > 0.0 ? 1.0 / average : 0.0) + " FPS)" +
+        ", min " + std::to_string(sortedFrameTimes.front() * 1000.0) +
+        " ms, p50 " + std::to_string(percentile(0.5)) +
+        " ms, p99 " + std::to_string(percentile(0.99)) +
+        " ms, max " + std::to_string(sortedFrameTimes.back() * 1000.0) + " ms"
+    );
+}
+
 void Game::Destroy() {
-    SDL_DestroyRenderer(renderer);
-    SDL_DestroyWindow(window);
+    // Headless runs log their own summary at the end of Run()
+    if (!isHeadless) {
+        FrameTimingStats stats = framePacer.GetStats();
+        Logger::Log(
+            "Frame pacing (" + std::string(FramePacer::GetModeName(framePacer.GetMode())) + ") over the last " +
+            std::to_string(stats.numFrames) + " frames: avg " + std::to_string(stats.averageFrameTime * 1000.0) +
+            " ms, min " + std::to_string(stats.minFrameTime * 1000.0) +
+            " ms, max " + std::to_string(stats.maxFrameTime * 1000.0) +
+            " ms, jitter " + std::to_string(stats.jitter * 1000.0) +
+            " ms, missed " + std::to_string(stats.numMissedFrames)
+        );
+    }
+    Profiler::LogReport();
+    Profiler::Shutdown();
+    performanceOverlay.Destroy();
+    if (renderer) {
+        SDL_DestroyRenderer(renderer);
+    }
+    if (window) {
+        SDL_DestroyWindow(window);
+    }
     SDL_Quit();
 }
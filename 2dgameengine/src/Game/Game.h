@@ -1,17 +1,60 @@
 #ifndef GAME_H
 #define GAME_H
 
+#include "../ECS/ECS.h"
+#include "../ECS/SystemScheduler.h"
+#include "../Jobs/JobSystem.h"
+#include "FramePacer.h"
+#include "PerformanceOverlay.h"
 #include <SDL2/SDL.h>
+#include <memory>
+#include <vector>
 
 const int FPS = 60;
-const int MILLISECS_PER_FRAME = 1000 / FPS;
+
+// The simulation advances in fixed steps, independently of the frame rate
+const int DEFAULT_SIMULATION_HZ = 120;
+
+// Steps run in a single frame at most, so a slow frame can't make the next one even slower
+const int MAX_SIMULATION_STEPS_PER_FRAME = 8;
+
+// Frame times kept for the summary of a headless run, the oldest ones are overwritten past that
+const int MAX_RECORDED_FRAME_TIMES = 1 << 20;
+
+// Frames captured by a trace started with the F9 key
+const int TRACE_CAPTURE_FRAMES = 300;
 
 class Game {
     private:
         bool isRunning;
-        int millisecsPreviousFrame = 0;
-        SDL_Window* window;
-        SDL_Renderer* renderer;
+        FramePacer framePacer;
+        PerformanceOverlay performanceOverlay;
+
+        // Headless runs have no window nor renderer, and stop after a number of frames or seconds
+        bool isHeadless = false;
+        int maxFrames = 0;
+        double maxDuration = 0.0;
+
+        // Frames run so far, and how long each of them took in a headless run
+        int numFrames = 0;
+        Uint64 runStartCounter = 0;
+        std::vector<double> frameTimes;
+
+        // Duration of a simulation step, and simulated time owed to the simulation
+        double fixedDeltaTime = 1.0 / DEFAULT_SIMULATION_HZ;
+        double accumulator = 0.0;
+
+        // How far the rendered frame is between the last two simulation states, from 0 to 1
+        double interpolationAlpha = 0.0;
+        SDL_Window* window = nullptr;
+        SDL_Renderer* renderer = nullptr;
+
+        std::unique_ptr<Registry> registry;
+        std::unique_ptr<JobSystem> jobSystem;
+        std::unique_ptr<SystemScheduler> systemScheduler;
+
+        bool HasReachedRunLimit() const;
+        void LogHeadlessSummary() const;
 
     public:
         Game();
@@ -21,9 +64,25 @@ class Game {
         void Setup();
         void ProcessInput();
         void Update();
+        void FixedUpdate(double deltaTime);
         void Render();
         void Destroy();
 
+        void SetSimulationRate(int hz);
+
+        // The vsync mode only takes effect if chosen before Initialize()
+        void SetFramePacingMode(FramePacingMode mode);
+
+        // Must be called before Initialize(). A headless game runs one simulation step per frame as
+        // fast as it can, without a window or a renderer, e.g. on servers or for benchmarks.
+        void SetHeadless(bool isHeadless);
+
+        // Stops the game after that many frames or seconds, 0 for no limit
+        void SetRunLimit(int maxFrames, double maxDuration);
+
+        // Writes the timings of the next frames to a trace file, for chrome://tracing or Perfetto
+        void StartTraceCapture(int numFrames);
+
         int windowWidth;
         int windowHeight;
 };
@@ -0,0 +1,171 @@
+#include "PerformanceOverlay.h"
+#include "../Components/ComponentTypes.h"
+#include "../Profiler/Profiler.h"
+#include <imgui/imgui.h>
+#include <imgui/imgui_sdl.h>
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+PerformanceOverlay::~PerformanceOverlay() {
+    Destroy();
+}
+
+void PerformanceOverlay::Initialize(SDL_Renderer* renderer, int windowWidth, int windowHeight) {
+    if (isInitialized) {
+        return;
+    }
+    ImGui::CreateContext();
+    ImGuiSDL::Initialize(renderer, windowWidth, windowHeight);
+    isInitialized = true;
+}
+
+void PerformanceOverlay::Destroy() {
+    if (!isInitialized) {
+        return;
+    }
+    ImGuiSDL::Deinitialize();
+    ImGui::DestroyContext();
+    isInitialized = false;
+}
+
+bool PerformanceOverlay::IsVisible() const {
+    return isVisible;
+}
+
+void PerformanceOverlay::Toggle() {
+    isVisible = !isVisible && isInitialized;
+}
+
+void PerformanceOverlay::ProcessEvent(const SDL_Event& sdlEvent) {
+    if (!isVisible) {
+        return;
+    }
+    if (sdlEvent.type == SDL_MOUSEWHEEL) {
+        ImGuiIO& io = ImGui::GetIO();
+        io.MouseWheel += static_cast<float>(sdlEvent.wheel.y);
+        io.MouseWheelH += static_cast<float>(sdlEvent.wheel.x);
+    }
+}
+
+static std::string FormatBytes(std::size_t bytes) {
+    char text[32];
+    if (bytes >= 1024 * 1024) {
+        std::snprintf(text, sizeof(text), "%.2f MB", bytes / (1024.0 * 1024.0));
+    } else {
+        std::snprintf(text, sizeof(text), "%.1f KB", bytes / 1024.0);
+    }
+    return text;
+}
+
+void PerformanceOverlay::ShowFrameTimes(const FramePacer& framePacer) {
+    FrameTimingStats stats = framePacer.GetStats();
+    std::vector<float> frameTimes = framePacer.GetFrameTimeHistory();
+
+    ImGui::Text("%.1f FPS, %.2f ms (%s)", stats.averageFrameTime > 0.0 ? 1.0 / stats.averageFrameTime : 0.0,
+        stats.averageFrameTime * 1000.0, FramePacer::GetModeName(framePacer.GetMode()));
+    ImGui::Text("min %.2f  max %.2f  jitter %.2f ms, %d missed", stats.minFrameTime * 1000.0,
+        stats.maxFrameTime * 1000.0, stats.jitter * 1000.0, stats.numMissedFrames);
+
+    // A fixed scale of twice the target keeps hitches easy to spot instead of rescaling the graph
+    float scaleMax = static_cast<float>(std::max(stats.targetFrameTime * 2.0, stats.maxFrameTime) * 1000.0);
+    ImGui::PlotLines("##FrameTimes", frameTimes.data(), static_cast<int>(frameTimes.size()), 0, "frame time (ms)",
+        0.0f, scaleMax, ImVec2(320.0f, 80.0f));
+}
+
+void PerformanceOverlay::ShowProfile() {
+    if (!ImGui::CollapsingHeader("Systems", ImGuiTreeNodeFlags_DefaultOpen)) {
+        return;
+    }
+    std::vector<ProfileNodeStats> tree = Profiler::GetFrameTree();
+    ImGui::Columns(4, "Profile");
+    ImGui::SetColumnWidth(0, 200.0f);
+    ImGui::Text("Scope (ms)"); ImGui::NextColumn();
+    ImGui::Text("avg"); ImGui::NextColumn();
+    ImGui::Text("p99"); ImGui::NextColumn();
+    ImGui::Text("last"); ImGui::NextColumn();
+    ImGui::Separator();
+    for (const auto& stats: tree) {
+        ImGui::Text("%*s%s", stats.depth * 2, "", stats.name); ImGui::NextColumn();
+        ImGui::Text("%.3f", stats.avgMs); ImGui::NextColumn();
+        ImGui::Text("%.3f", stats.p99Ms); ImGui::NextColumn();
+        ImGui::Text("%.3f", stats.lastMs); ImGui::NextColumn();
+    }
+    ImGui::Columns(1);
+}
+
+void PerformanceOverlay::ShowEntities(const Registry& registry) {
+    if (!ImGui::CollapsingHeader("Entities", ImGuiTreeNodeFlags_DefaultOpen)) {
+        return;
+    }
+    ImGui::Text("%d entities", registry.GetNumEntities());
+
+    std::size_t totalMemoryUsage = 0;
+    ImGui::Columns(3, "Components");
+    ImGui::SetColumnWidth(0, 200.0f);
+    ImGui::Text("Component"); ImGui::NextColumn();
+    ImGui::Text("count"); ImGui::NextColumn();
+    ImGui::Text("pool memory"); ImGui::NextColumn();
+    ImGui::Separator();
+    for (int componentId = 0; componentId < ComponentTypes::size; componentId++) {
+        std::size_t memoryUsage = registry.GetPoolMemoryUsage(componentId);
+        totalMemoryUsage += memoryUsage;
+        ImGui::Text("%s", COMPONENT_NAMES[componentId]); ImGui::NextColumn();
+        ImGui::Text("%d", registry.GetNumComponents(componentId)); ImGui::NextColumn();
+        ImGui::Text("%s", FormatBytes(memoryUsage).c_str()); ImGui::NextColumn();
+    }
+    ImGui::Columns(1);
+
+    std::size_t archetypeMemoryUsage = registry.GetArchetypeMemoryUsage();
+    if (archetypeMemoryUsage > 0) {
+        ImGui::Text("Archetype chunks: %s", FormatBytes(archetypeMemoryUsage).c_str());
+        totalMemoryUsage += archetypeMemoryUsage;
+    }
+    ImGui::Text("Total component memory: %s", FormatBytes(totalMemoryUsage).c_str());
+}
+
+void PerformanceOverlay::ShowRendering(int numGameDrawCalls) {
+    if (!ImGui::CollapsingHeader("Rendering", ImGuiTreeNodeFlags_DefaultOpen)) {
+        return;
+    }
+    ImGui::Text("Draw calls: %d game, %d overlay (%d vertices)", numGameDrawCalls, numImGuiDrawCalls, numImGuiVertices);
+
+    // The game draws plain rectangles, so every texture belongs to the imgui renderer
+    ImGui::Text("Texture memory: %s", FormatBytes(ImGuiSDL::GetTextureMemoryUsage()).c_str());
+}
+
+void PerformanceOverlay::Render(const Registry& registry, const FramePacer& framePacer, int numGameDrawCalls) {
+    if (!isVisible) {
+        return;
+    }
+    PROFILE_SCOPE("PerformanceOverlay");
+
+    ImGuiIO& io = ImGui::GetIO();
+    io.DeltaTime = static_cast<float>(std::max(framePacer.GetLastFrameTime(), 1.0e-4));
+    int mouseX, mouseY;
+    const Uint32 buttons = SDL_GetMouseState(&mouseX, &mouseY);
+    io.MousePos = ImVec2(static_cast<float>(mouseX), static_cast<float>(mouseY));
+    io.MouseDown[0] = buttons & SDL_BUTTON(SDL_BUTTON_LEFT);
+    io.MouseDown[1] = buttons & SDL_BUTTON(SDL_BUTTON_RIGHT);
+
+    ImGui::NewFrame();
+    ImGui::SetNextWindowPos(ImVec2(10.0f, 10.0f), ImGuiCond_Once);
+    ImGui::SetNextWindowBgAlpha(0.85f);
+    if (ImGui::Begin("Performance", nullptr, ImGuiWindowFlags_AlwaysAutoResize)) {
+        ShowFrameTimes(framePacer);
+        ShowProfile();
+        ShowEntities(registry);
+        ShowRendering(numGameDrawCalls);
+    }
+    ImGui::End();
+    ImGui::Render();
+
+    ImDrawData* drawData = ImGui::GetDrawData();
+    numImGuiDrawCalls = 0;
+    for (int i = 0; i < drawData->CmdListsCount; i++) {
+        numImGuiDrawCalls += drawData->CmdLists[i]->CmdBuffer.Size;
+    }
+    numImGuiVertices = drawData->TotalVtxCount;
+    ImGuiSDL::Render(drawData);
+}
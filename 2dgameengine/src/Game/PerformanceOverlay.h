@@ -0,0 +1,47 @@
+#ifndef PERFORMANCEOVERLAY_H
+#define PERFORMANCEOVERLAY_H
+
+#include <SDL2/SDL.h>
+#include "../ECS/ECS.h"
+#include "FramePacer.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// PerformanceOverlay
+////////////////////////////////////////////////////////////////////////////////
+// An imgui window drawn over the game with the frame time graph, the time
+// of every profiled scope, the entity and component counts, the memory of
+// the component storage and what was drawn in the last frame. While hidden
+// it doesn't start an imgui frame nor gather anything, so it costs nothing.
+////////////////////////////////////////////////////////////////////////////////
+class PerformanceOverlay {
+    private:
+        bool isInitialized = false;
+        bool isVisible = false;
+
+        // What imgui drew for the overlay itself in the last frame
+        int numImGuiDrawCalls = 0;
+        int numImGuiVertices = 0;
+
+        void ShowFrameTimes(const FramePacer& framePacer);
+        void ShowProfile();
+        void ShowEntities(const Registry& registry);
+        void ShowRendering(int numGameDrawCalls);
+
+    public:
+        PerformanceOverlay() = default;
+        ~PerformanceOverlay();
+
+        void Initialize(SDL_Renderer* renderer, int windowWidth, int windowHeight);
+        void Destroy();
+
+        bool IsVisible() const;
+        void Toggle();
+
+        // Forwards the input that imgui can't poll, e.g. the mouse wheel
+        void ProcessEvent(const SDL_Event& sdlEvent);
+
+        // Draws the overlay if visible, call it after the game was rendered
+        void Render(const Registry& registry, const FramePacer& framePacer, int numGameDrawCalls);
+};
+
+#endif
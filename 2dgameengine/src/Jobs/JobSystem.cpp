@@ -0,0 +1,143 @@
+#include "JobSystem.h"
+
+// The job system the current thread works for and its index in it, if any
+static thread_local const JobSystem* currentJobSystem = nullptr;
+static thread_local int currentWorkerIndex = -1;
+
+JobSystem::JobSystem(int numThreads) {
+    if (numThreads <= 0) {
+        // hardware_concurrency() may return 0 when the number of cores is unknown
+        numThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    }
+    for (int i = 0; i < numThreads; i++) {
+        queues.push_back(std::make_unique<WorkStealingQueue<Job>>());
+    }
+
+    currentJobSystem = this;
+    currentWorkerIndex = 0;
+    for (int i = 1; i < numThreads; i++) {
+        workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem() {
+    isStopping = true;
+    WakeWorkers();
+    for (auto& worker: workers) {
+        worker.join();
+    }
+
+    // Jobs that nobody waited for are dropped
+    for (auto& queue: queues) {
+        while (Job* job = queue->Steal()) {
+            delete job;
+        }
+    }
+    for (Job* job: sharedQueue) {
+        delete job;
+    }
+    if (currentJobSystem == this) {
+        currentJobSystem = nullptr;
+        currentWorkerIndex = -1;
+    }
+}
+
+int JobSystem::GetNumThreads() const {
+    return static_cast<int>(queues.size());
+}
+
+int JobSystem::GetCurrentWorkerIndex() const {
+    return currentJobSystem == this ? currentWorkerIndex : -1;
+}
+
+void JobSystem::WakeWorkers() {
+    numSubmittedJobs++;
+    if (numSleepingWorkers > 0 || isStopping) {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        jobSubmitted.notify_all();
+    }
+}
+
+void JobSystem::Run(std::function<void()> task, JobCounter* counter) {
+    if (counter) {
+        counter->numPendingJobs.fetch_add(1, std::memory_order_relaxed);
+    }
+    Job* job = new Job{std::move(task), counter};
+
+    int workerIndex = GetCurrentWorkerIndex();
+    if (workerIndex == -1) {
+        std::lock_guard<std::mutex> lock(sharedQueueMutex);
+        sharedQueue.push_back(job);
+    } else if (!queues[workerIndex]->Push(job)) {
+        // The queue of this worker is full, run the job right away
+        Execute(job);
+        return;
+    }
+    WakeWorkers();
+}
+
+Job* JobSystem::FindJob(int workerIndex) {
+    // Newest job of our own queue first, as its data is likely still in cache
+    if (workerIndex != -1) {
+        if (Job* job = queues[workerIndex]->Pop()) {
+            return job;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(sharedQueueMutex);
+        if (!sharedQueue.empty()) {
+            Job* job = sharedQueue.front();
+            sharedQueue.pop_front();
+            return job;
+        }
+    }
+    // Then steal the oldest job of another worker, starting from our neighbour
+    int numQueues = GetNumThreads();
+    for (int i = 1; i <= numQueues; i++) {
+        int victim = (workerIndex + i + numQueues) % numQueues;
+        if (victim == workerIndex) {
+            continue;
+        }
+        if (Job* job = queues[victim]->Steal()) {
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+void JobSystem::Execute(Job* job) {
+    job->task();
+    if (job->counter) {
+        job->counter->numPendingJobs.fetch_sub(1, std::memory_order_acq_rel);
+    }
+    delete job;
+}
+
+void JobSystem::Wait(const JobCounter& counter) {
+    int workerIndex = GetCurrentWorkerIndex();
+    while (!counter.IsDone()) {
+        if (Job* job = FindJob(workerIndex)) {
+            Execute(job);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::WorkerLoop(int workerIndex) {
+    currentJobSystem = this;
+    currentWorkerIndex = workerIndex;
+
+    while (!isStopping) {
+        unsigned submittedBefore = numSubmittedJobs;
+        if (Job* job = FindJob(workerIndex)) {
+            Execute(job);
+            continue;
+        }
+        // Nothing to do, sleep until a job is submitted after we looked
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        numSleepingWorkers++;
+        jobSubmitted.wait(lock, [this, submittedBefore] { return isStopping || numSubmittedJobs != submittedBefore; });
+        numSleepingWorkers--;
+    }
+}
@@ -0,0 +1,142 @@
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "WorkStealingQueue.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// JobCounter
+////////////////////////////////////////////////////////////////////////////////
+// Counts the jobs of a group that are still queued or running, so a thread
+// can wait for the whole group to finish.
+////////////////////////////////////////////////////////////////////////////////
+class JobCounter {
+    private:
+        std::atomic<int> numPendingJobs{0};
+
+        friend class JobSystem;
+
+    public:
+        bool IsDone() const { return numPendingJobs.load(std::memory_order_acquire) == 0; }
+};
+
+struct Job {
+    std::function<void()> task;
+    JobCounter* counter = nullptr;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// JobSystem
+////////////////////////////////////////////////////////////////////////////////
+// The engine-wide pool of worker threads, one per core. The thread that
+// creates the job system counts as worker 0 and the others are spawned. Each
+// worker has its own work stealing queue: jobs submitted by a worker go to
+// the bottom of its queue, and idle workers steal from the top of the
+// others'. Jobs submitted from any other thread go to a shared queue.
+// A thread waiting for a counter runs any queued job instead of blocking,
+// while a thread waiting for a ParallelFor only runs batches of that loop.
+////////////////////////////////////////////////////////////////////////////////
+class JobSystem {
+    private:
+        std::vector<std::unique_ptr<WorkStealingQueue<Job>>> queues;
+        std::vector<std::thread> workers;
+
+        // Jobs submitted by threads that are not workers of this job system
+        std::deque<Job*> sharedQueue;
+        std::mutex sharedQueueMutex;
+
+        // Idle workers sleep until something is submitted
+        std::atomic<unsigned> numSubmittedJobs{0};
+        std::atomic<int> numSleepingWorkers{0};
+        std::atomic<bool> isStopping{false};
+        std::mutex sleepMutex;
+        std::condition_variable jobSubmitted;
+
+        void WorkerLoop(int workerIndex);
+        int GetCurrentWorkerIndex() const;
+        Job* FindJob(int workerIndex);
+        void Execute(Job* job);
+        void WakeWorkers();
+
+    public:
+        JobSystem(int numThreads = 0);
+        ~JobSystem();
+
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator =(const JobSystem&) = delete;
+
+        // Number of threads running jobs, including the one that created the job system
+        int GetNumThreads() const;
+
+        // Queues a task, the counter (if any) is increased now and decreased once the task has run
+        void Run(std::function<void()> task, JobCounter* counter = nullptr);
+
+        // Runs queued jobs on the calling thread until all the jobs of the counter are done. The jobs
+        // it runs are not limited to those of the counter: any job may run on this thread, nested in
+        // whatever the caller is in the middle of (a profiler scope, a system update, a held lock).
+        // Only wait where that is safe, e.g. at the top of a frame; ParallelFor is the restricted path.
+        void Wait(const JobCounter& counter);
+
+        // Calls func(begin, end) on batches that cover [0, count) in parallel and waits for all of
+        // them. The batch size is a multiple of "batchAlignment" items, so when the items are packed
+        // in arrays, e.g. 16 floats per 64-byte cache line, no two batches write to the same line.
+        // While it waits, the calling thread only runs batches of this loop, never unrelated jobs,
+        // so whatever it was doing (e.g. a profiler scope) is not interleaved with other work.
+        template <typename TFunc> void ParallelFor(int count, int batchAlignment, TFunc&& func);
+};
+
+template <typename TFunc>
+void JobSystem::ParallelFor(int count, int batchAlignment, TFunc&& func) {
+    // Below this many items per batch, scheduling a job costs more than it saves
+    const int MIN_BATCH_SIZE = 2048;
+
+    // A few batches per thread, so the threads that finish early can take more of them
+    int numBatches = GetNumThreads() * 4;
+    int batchSize = std::max((count + numBatches - 1) / numBatches, MIN_BATCH_SIZE);
+    batchSize = (batchSize + batchAlignment - 1) / batchAlignment * batchAlignment;
+
+    if (count <= batchSize || GetNumThreads() == 1) {
+        if (count > 0) {
+            func(0, count);
+        }
+        return;
+    }
+    numBatches = (count + batchSize - 1) / batchSize;
+
+    // The batches are claimed one at a time from a shared cursor, by the calling thread and
+    // by helper jobs. A helper that starts after every batch was claimed returns without
+    // touching func, so the state it reads is shared rather than on this stack.
+    struct Batches {
+        std::atomic<int> nextBatch{0};
+        std::atomic<int> numDoneBatches{0};
+    };
+    auto batches = std::make_shared<Batches>();
+    auto runBatches = [batches, &func, count, batchSize, numBatches] {
+        for (int batch = batches->nextBatch++; batch < numBatches; batch = batches->nextBatch++) {
+            int begin = batch * batchSize;
+            func(begin, std::min(begin + batchSize, count));
+            batches->numDoneBatches.fetch_add(1, std::memory_order_acq_rel);
+        }
+    };
+
+    int numHelpers = std::min(numBatches, GetNumThreads()) - 1;
+    for (int i = 0; i < numHelpers; i++) {
+        Run(runBatches);
+    }
+    runBatches();
+
+    // Every batch is claimed, wait for the helpers still running theirs
+    while (batches->numDoneBatches.load(std::memory_order_acquire) < numBatches) {
+        std::this_thread::yield();
+    }
+}
+
+#endif
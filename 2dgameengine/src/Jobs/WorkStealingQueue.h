@@ -0,0 +1,87 @@
+#ifndef WORKSTEALINGQUEUE_H
+#define WORKSTEALINGQUEUE_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Size in bytes of a cache line, used to keep data written by different threads apart
+const int CACHE_LINE_SIZE = 64;
+
+////////////////////////////////////////////////////////////////////////////////
+// WorkStealingQueue
+////////////////////////////////////////////////////////////////////////////////
+// A Chase-Lev deque of fixed capacity. The thread that owns the queue pushes
+// and pops items at the bottom without locking, like a stack, while other
+// threads steal the oldest items from the top.
+////////////////////////////////////////////////////////////////////////////////
+template <typename T, int CAPACITY = 4096>
+class WorkStealingQueue {
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "The capacity of the queue must be a power of two");
+
+    private:
+        static const std::int64_t MASK = CAPACITY - 1;
+
+        // Kept on their own cache lines, as "top" is written by thieves and "bottom" by the owner
+        alignas(CACHE_LINE_SIZE) std::atomic<std::int64_t> top{0};
+        alignas(CACHE_LINE_SIZE) std::atomic<std::int64_t> bottom{0};
+        alignas(CACHE_LINE_SIZE) std::array<std::atomic<T*>, CAPACITY> items;
+
+    public:
+        WorkStealingQueue() = default;
+        WorkStealingQueue(const WorkStealingQueue&) = delete;
+        WorkStealingQueue& operator =(const WorkStealingQueue&) = delete;
+
+        // Owner only, returns false if the queue is full
+        bool Push(T* item) {
+            std::int64_t b = bottom.load(std::memory_order_relaxed);
+            std::int64_t t = top.load(std::memory_order_acquire);
+            if (b - t >= CAPACITY) {
+                return false;
+            }
+            items[b & MASK].store(item, std::memory_order_relaxed);
+            // Publishes the item, and whatever it points to, to the thieves
+            bottom.store(b + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Owner only, takes the newest item or returns nullptr if the queue is empty
+        T* Pop() {
+            std::int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+            bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            std::int64_t t = top.load(std::memory_order_relaxed);
+
+            if (t > b) {
+                // The queue was empty
+                bottom.store(b + 1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            T* item = items[b & MASK].load(std::memory_order_relaxed);
+            if (t == b) {
+                // Last item left, race the thieves for it
+                if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                    item = nullptr;
+                }
+                bottom.store(b + 1, std::memory_order_relaxed);
+            }
+            return item;
+        }
+
+        // Any thread, takes the oldest item or returns nullptr if the queue is empty or another thread won it
+        T* Steal() {
+            std::int64_t t = top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            std::int64_t b = bottom.load(std::memory_order_acquire);
+            if (t >= b) {
+                return nullptr;
+            }
+            T* item = items[t & MASK].load(std::memory_order_relaxed);
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                return nullptr;
+            }
+            return item;
+        }
+};
+
+#endif
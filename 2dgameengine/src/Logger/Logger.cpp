@@ -3,9 +3,13 @@
 #include <string>
 #include <chrono>
 #include <ctime>
+#include <mutex>
 
 std::vector<LogEntry> Logger::messages;
 
+// Systems may log from worker threads
+static std::mutex logMutex;
+
 std::string CurrentDateTimeToString() {
     std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
     std::string output(30, '\0');
@@ -17,6 +21,7 @@ void Logger::Log(const std::string& message) {
     LogEntry logEntry;
     logEntry.type = LOG_INFO;
     logEntry.message = "LOG: [" + CurrentDateTimeToString() + "]: " + message;
+    std::lock_guard<std::mutex> lock(logMutex);
     std::cout << "\x1B[32m" << logEntry.message << "\033[0m" << std::endl;
     messages.push_back(logEntry);
 }
@@ -25,6 +30,7 @@ void Logger::Err(const std::string& message) {
     LogEntry logEntry;
     logEntry.type = LOG_ERROR;
     logEntry.message = "ERR: [" + CurrentDateTimeToString() + "]: " + message;
+    std::lock_guard<std::mutex> lock(logMutex);
     messages.push_back(logEntry);
     std::cerr << "\x1B[91m"<< logEntry.message << "\033[0m" << std::endl;
 }
@@ -1,9 +1,38 @@
 #include "./Game/Game.h"
+#include "./Logger/Logger.h"
+#include <cstdlib>
+#include <string>
 
 int main(int argc, char* argv[]) {
     Game game;
 
+    int maxFrames = 0;
+    double maxDuration = 0.0;
+    int traceFrames = 0;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--vsync") {
+            game.SetFramePacingMode(PACING_VSYNC);
+        } else if (arg == "--uncapped") {
+            game.SetFramePacingMode(PACING_UNCAPPED);
+        } else if (arg == "--headless") {
+            game.SetHeadless(true);
+        } else if (arg == "--frames" && i + 1 < argc) {
+            maxFrames = std::atoi(argv[++i]);
+        } else if (arg == "--duration" && i + 1 < argc) {
+            maxDuration = std::atof(argv[++i]);
+        } else if (arg == "--trace" && i + 1 < argc) {
+            traceFrames = std::atoi(argv[++i]);
+        } else {
+            Logger::Err("Unknown argument: " + arg);
+        }
+    }
+    game.SetRunLimit(maxFrames, maxDuration);
+
     game.Initialize();
+    if (traceFrames > 0) {
+        game.StartTraceCapture(traceFrames);
+    }
     game.Run();
     game.Destroy();
 
@@ -0,0 +1,242 @@
+#include "Profiler.h"
+#include "../Logger/Logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+std::vector<std::unique_ptr<Profiler::ThreadProfile>> Profiler::threads;
+std::mutex Profiler::threadsMutex;
+thread_local Profiler::ThreadProfile* Profiler::currentThreadProfile = nullptr;
+std::vector<Profiler::ProfileNode> Profiler::nodes;
+int Profiler::nextSample = 0;
+std::int64_t Profiler::lastFrameEndTime = 0;
+int Profiler::numTraceFramesLeft = 0;
+std::string Profiler::traceFilePath;
+std::vector<TraceEvent> Profiler::traceEvents;
+TraceWriter Profiler::traceWriter;
+
+// Index of the root nodes, created on the first frame
+static const int FRAME_NODE = 0;
+static const int WORKER_THREADS_NODE = 1;
+
+std::int64_t Profiler::Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Profiler::ThreadProfile* Profiler::GetThreadProfile() {
+    if (!currentThreadProfile) {
+        std::lock_guard<std::mutex> lock(threadsMutex);
+        threads.push_back(std::make_unique<ThreadProfile>());
+        threads.back()->threadIndex = static_cast<int>(threads.size()) - 1;
+        currentThreadProfile = threads.back().get();
+    }
+    return currentThreadProfile;
+}
+
+void Profiler::BeginScope(const char* name) {
+    ThreadProfile* thread = GetThreadProfile();
+    if (!thread->events.Push({name, Now(), true})) {
+        thread->numDroppedEvents.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Profiler::EndScope(const char* name) {
+    ThreadProfile* thread = GetThreadProfile();
+    if (!thread->events.Push({name, Now(), false})) {
+        thread->numDroppedEvents.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+int Profiler::FindOrAddChild(int parent, const char* name) {
+    for (int child: nodes[parent].children) {
+        // Names are compared by value, the same literal may have a different address in each file
+        if (nodes[child].name == name || std::strcmp(nodes[child].name, name) == 0) {
+            return child;
+        }
+    }
+    ProfileNode node;
+    node.name = name;
+    node.parent = parent;
+    node.depth = nodes[parent].depth + 1;
+    nodes.push_back(node);
+    int child = static_cast<int>(nodes.size()) - 1;
+    nodes[parent].children.push_back(child);
+    return child;
+}
+
+void Profiler::DrainEvents(ThreadProfile& thread, int rootNode) {
+    ProfileEvent event;
+    while (thread.events.Pop(event)) {
+        if (numTraceFramesLeft > 0) {
+            traceEvents.push_back({event.name, event.time, 0, thread.threadIndex, event.isBegin ? 'B' : 'E'});
+        }
+        if (event.isBegin) {
+            int parent = thread.openScopes.empty() ? rootNode : thread.openScopes.back().node;
+            thread.openScopes.push_back({FindOrAddChild(parent, event.name), event.time});
+            continue;
+        }
+        // If events were dropped, close the scopes whose end was lost until we find the matching one
+        while (!thread.openScopes.empty()) {
+            OpenScope scope = thread.openScopes.back();
+            thread.openScopes.pop_back();
+            if (std::strcmp(nodes[scope.node].name, event.name) == 0) {
+                nodes[scope.node].frameTime += event.time - scope.beginTime;
+                nodes[scope.node].frameCalls++;
+                break;
+            }
+        }
+    }
+}
+
+void Profiler::EndFrame() {
+    std::int64_t frameEndTime = Now();
+    if (nodes.empty()) {
+        nodes.push_back({"Frame", -1, 0, {}});
+        // Not in the children of "Frame", so it is listed after everything that ran on this thread
+        nodes.push_back({"Worker threads", FRAME_NODE, 1, {}});
+        lastFrameEndTime = frameEndTime;
+    }
+
+    ThreadProfile* mainThread = GetThreadProfile();
+    {
+        std::lock_guard<std::mutex> lock(threadsMutex);
+        for (auto& thread: threads) {
+            DrainEvents(*thread, thread.get() == mainThread ? FRAME_NODE : WORKER_THREADS_NODE);
+        }
+    }
+    nodes[FRAME_NODE].frameTime = frameEndTime - lastFrameEndTime;
+    nodes[FRAME_NODE].frameCalls = 1;
+
+    if (numTraceFramesLeft > 0) {
+        traceEvents.push_back({"Frame", lastFrameEndTime, frameEndTime - lastFrameEndTime, mainThread->threadIndex, 'X'});
+        numTraceFramesLeft--;
+        if (numTraceFramesLeft == 0) {
+            traceWriter.Write(traceFilePath, std::move(traceEvents), mainThread->threadIndex);
+            traceEvents = std::vector<TraceEvent>();
+        }
+    }
+    lastFrameEndTime = frameEndTime;
+
+    // Time of the worker threads, summed over all of them
+    ProfileNode& workerThreads = nodes[WORKER_THREADS_NODE];
+    workerThreads.frameTime = 0;
+    workerThreads.frameCalls = 0;
+    for (int child: workerThreads.children) {
+        workerThreads.frameTime += nodes[child].frameTime;
+        workerThreads.frameCalls += nodes[child].frameCalls;
+    }
+
+    // Scopes that didn't run this frame count as 0 ms
+    for (auto& node: nodes) {
+        node.samples[nextSample] = static_cast<float>(node.frameTime / 1.0e6);
+        node.numSamples = std::min(node.numSamples + 1, PROFILER_WINDOW_SIZE);
+        node.lastCalls = node.frameCalls;
+        node.frameTime = 0;
+        node.frameCalls = 0;
+    }
+    nextSample = (nextSample + 1) % PROFILER_WINDOW_SIZE;
+}
+
+ProfileNodeStats Profiler::ComputeStats(const ProfileNode& node) {
+    ProfileNodeStats stats = {node.name, node.depth, node.lastCalls, 0.0, 0.0, 0.0, 0.0};
+    if (node.numSamples == 0) {
+        return stats;
+    }
+    stats.lastMs = node.samples[(nextSample + PROFILER_WINDOW_SIZE - 1) % PROFILER_WINDOW_SIZE];
+
+    // The newest samples, the node may be younger than the window
+    std::vector<float> samples;
+    samples.reserve(node.numSamples);
+    for (int i = 1; i <= node.numSamples; i++) {
+        samples.push_back(node.samples[(nextSample + PROFILER_WINDOW_SIZE - i) % PROFILER_WINDOW_SIZE]);
+    }
+    double sum = 0.0;
+    stats.minMs = samples[0];
+    for (float sample: samples) {
+        sum += sample;
+        stats.minMs = std::min(stats.minMs, static_cast<double>(sample));
+    }
+    stats.avgMs = sum / samples.size();
+
+    size_t p99Index = (samples.size() * 99 + 99) / 100 - 1;
+    std::nth_element(samples.begin(), samples.begin() + p99Index, samples.end());
+    stats.p99Ms = samples[p99Index];
+    return stats;
+}
+
+std::vector<ProfileNodeStats> Profiler::GetFrameTree() {
+    std::vector<ProfileNodeStats> tree;
+    if (nodes.empty()) {
+        return tree;
+    }
+    tree.reserve(nodes.size());
+    // The worker threads node is only worth showing if something ran there
+    std::vector<int> stack;
+    if (!nodes[WORKER_THREADS_NODE].children.empty()) {
+        stack.push_back(WORKER_THREADS_NODE);
+    }
+    stack.push_back(FRAME_NODE);
+    while (!stack.empty()) {
+        int node = stack.back();
+        stack.pop_back();
+        tree.push_back(ComputeStats(nodes[node]));
+        // Pushed in reverse so the children come out in the order they first ran
+        stack.insert(stack.end(), nodes[node].children.rbegin(), nodes[node].children.rend());
+    }
+    return tree;
+}
+
+unsigned Profiler::GetNumDroppedEvents() {
+    std::lock_guard<std::mutex> lock(threadsMutex);
+    unsigned numDroppedEvents = 0;
+    for (auto& thread: threads) {
+        numDroppedEvents += thread->numDroppedEvents.load(std::memory_order_relaxed);
+    }
+    return numDroppedEvents;
+}
+
+void Profiler::LogReport() {
+    std::vector<ProfileNodeStats> tree = GetFrameTree();
+    if (tree.empty()) {
+        return;
+    }
+    Logger::Log("Profile over the last " + std::to_string(std::min(nodes[FRAME_NODE].numSamples, PROFILER_WINDOW_SIZE)) + " frames (ms):");
+    for (const auto& stats: tree) {
+        char line[160];
+        std::snprintf(line, sizeof(line), "%*s%-*s calls %4d  min %8.3f  avg %8.3f  p99 %8.3f",
+            stats.depth * 2, "", 32 - stats.depth * 2, stats.name, stats.calls, stats.minMs, stats.avgMs, stats.p99Ms);
+        Logger::Log(line);
+    }
+    unsigned numDroppedEvents = GetNumDroppedEvents();
+    if (numDroppedEvents > 0) {
+        Logger::Err("The profiler dropped " + std::to_string(numDroppedEvents) + " events, some timings are incomplete.");
+    }
+}
+
+void Profiler::StartTraceCapture(const std::string& filePath, int numFrames) {
+    if (numFrames <= 0) {
+        Logger::Err("Invalid number of frames to trace: " + std::to_string(numFrames) + ".");
+        return;
+    }
+    Logger::Log("Capturing a trace of " + std::to_string(numFrames) + " frames to " + filePath + ".");
+    traceFilePath = filePath;
+    traceEvents.clear();
+    numTraceFramesLeft = numFrames;
+}
+
+bool Profiler::IsCapturingTrace() {
+    return numTraceFramesLeft > 0;
+}
+
+void Profiler::Shutdown() {
+    if (numTraceFramesLeft > 0) {
+        // Keep the frames captured so far rather than nothing
+        ThreadProfile* mainThread = GetThreadProfile();
+        traceWriter.Write(traceFilePath, std::move(traceEvents), mainThread->threadIndex);
+        traceEvents = std::vector<TraceEvent>();
+        numTraceFramesLeft = 0;
+    }
+    traceWriter.Wait();
+}
@@ -0,0 +1,191 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "../Jobs/WorkStealingQueue.h"
+#include "TraceWriter.h"
+
+// Frames the min/avg/p99 of each scope are computed over
+const int PROFILER_WINDOW_SIZE = 120;
+
+struct ProfileEvent {
+    // Must outlive the profiler, usually a string literal
+    const char* name;
+    // Nanoseconds on the steady clock
+    std::int64_t time;
+    bool isBegin;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// ProfileEventRing
+////////////////////////////////////////////////////////////////////////////////
+// A lock-free ring buffer with a single producer, the thread being profiled,
+// and a single consumer, the thread that ends the frames. When the ring is
+// full, events are dropped rather than blocking the producer.
+////////////////////////////////////////////////////////////////////////////////
+class ProfileEventRing {
+    private:
+        static constexpr std::uint32_t CAPACITY = 8192;
+        static constexpr std::uint32_t MASK = CAPACITY - 1;
+
+        alignas(CACHE_LINE_SIZE) std::atomic<std::uint32_t> writeIndex{0};
+        alignas(CACHE_LINE_SIZE) std::atomic<std::uint32_t> readIndex{0};
+        alignas(CACHE_LINE_SIZE) std::array<ProfileEvent, CAPACITY> events;
+
+    public:
+        // Producer only, returns false if the ring is full
+        bool Push(const ProfileEvent& event) {
+            std::uint32_t write = writeIndex.load(std::memory_order_relaxed);
+            if (write - readIndex.load(std::memory_order_acquire) >= CAPACITY) {
+                return false;
+            }
+            events[write & MASK] = event;
+            writeIndex.store(write + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer only, returns false if the ring is empty
+        bool Pop(ProfileEvent& event) {
+            std::uint32_t read = readIndex.load(std::memory_order_relaxed);
+            if (read == writeIndex.load(std::memory_order_acquire)) {
+                return false;
+            }
+            event = events[read & MASK];
+            readIndex.store(read + 1, std::memory_order_release);
+            return true;
+        }
+};
+
+// Timings of a scope, in milliseconds per frame over the rolling window
+struct ProfileNodeStats {
+    const char* name;
+    int depth;
+    int calls;
+    double lastMs;
+    double minMs;
+    double avgMs;
+    double p99Ms;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Profiler
+////////////////////////////////////////////////////////////////////////////////
+// Records nested CPU timings with PROFILE_SCOPE. Every thread pushes the
+// begin and end of its scopes into its own ring, without locking, and the
+// thread that calls EndFrame() drains all the rings into a tree of scopes
+// keyed by their call path. The scopes opened on the thread that ends the
+// frames nest under "Frame"; the ones of other threads, e.g. systems run
+// by the job system, nest under "Worker threads", so their times add up
+// across threads. Each node keeps its time of the last frames, from which
+// the min/avg/p99 are computed. A trace capture also copies the raw events
+// of a number of frames, which are then written as trace event JSON.
+////////////////////////////////////////////////////////////////////////////////
+class Profiler {
+    private:
+        struct OpenScope {
+            int node;
+            std::int64_t beginTime;
+        };
+
+        struct ThreadProfile {
+            int threadIndex;
+            ProfileEventRing events;
+            std::atomic<unsigned> numDroppedEvents{0};
+            // Consumer side: scopes whose end wasn't drained yet
+            std::vector<OpenScope> openScopes;
+        };
+
+        struct ProfileNode {
+            const char* name;
+            int parent;
+            int depth;
+            std::vector<int> children;
+            // Time spent in the scope and calls during the frame being collected
+            std::int64_t frameTime = 0;
+            int frameCalls = 0;
+            int lastCalls = 0;
+            // Circular buffer of the time of the last frames, in milliseconds
+            std::array<float, PROFILER_WINDOW_SIZE> samples{};
+            int numSamples = 0;
+        };
+
+        static std::vector<std::unique_ptr<ThreadProfile>> threads;
+        static std::mutex threadsMutex;
+
+        // The profile of the current thread, registered on its first scope
+        static thread_local ThreadProfile* currentThreadProfile;
+
+        static std::vector<ProfileNode> nodes;
+        static int nextSample;
+        static std::int64_t lastFrameEndTime;
+
+        // Trace capture in progress, if any frames are left
+        static int numTraceFramesLeft;
+        static std::string traceFilePath;
+        static std::vector<TraceEvent> traceEvents;
+        static TraceWriter traceWriter;
+
+        static ThreadProfile* GetThreadProfile();
+        static int FindOrAddChild(int parent, const char* name);
+        static void DrainEvents(ThreadProfile& thread, int rootNode);
+        static ProfileNodeStats ComputeStats(const ProfileNode& node);
+
+    public:
+        static std::int64_t Now();
+
+        static void BeginScope(const char* name);
+        static void EndScope(const char* name);
+
+        // Collects the scopes that ended since the last call, call it once per frame on the same thread
+        static void EndFrame();
+
+        // The tree of scopes in depth-first order, children after their parent
+        static std::vector<ProfileNodeStats> GetFrameTree();
+
+        // Events lost because a ring was full, the timings are incomplete if not zero
+        static unsigned GetNumDroppedEvents();
+
+        static void LogReport();
+
+        // Captures the events of all threads during the next frames, and writes them to the file
+        // once done. A capture already in progress is restarted.
+        static void StartTraceCapture(const std::string& filePath, int numFrames);
+        static bool IsCapturingTrace();
+
+        // Waits for the last trace to be written, call it before exiting
+        static void Shutdown();
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// ProfileScope
+////////////////////////////////////////////////////////////////////////////////
+// Times the enclosing scope, use it through PROFILE_SCOPE.
+////////////////////////////////////////////////////////////////////////////////
+class ProfileScope {
+    private:
+        const char* name;
+
+    public:
+        ProfileScope(const char* name): name(name) { Profiler::BeginScope(name); }
+        ~ProfileScope() { Profiler::EndScope(name); }
+
+        ProfileScope(const ProfileScope&) = delete;
+        ProfileScope& operator =(const ProfileScope&) = delete;
+};
+
+// Build with -DDISABLE_PROFILER to compile the scopes out
+#ifdef DISABLE_PROFILER
+#define PROFILE_SCOPE(name)
+#else
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#endif
+
+#endif
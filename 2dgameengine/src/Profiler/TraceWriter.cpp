@@ -0,0 +1,111 @@
+#include "TraceWriter.h"
+#include "../Logger/Logger.h"
+#include <algorithm>
+#include <cstdio>
+#include <set>
+
+TraceWriter::~TraceWriter() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        isStopping = true;
+    }
+    queueCondition.notify_all();
+    if (writerThread.joinable()) {
+        writerThread.join();
+    }
+}
+
+void TraceWriter::Write(const std::string& filePath, std::vector<TraceEvent>&& events, int mainThreadIndex) {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        queuedFiles.push_back({filePath, std::move(events), mainThreadIndex});
+        // The thread is only started by the first capture
+        if (!writerThread.joinable()) {
+            writerThread = std::thread(&TraceWriter::WriterLoop, this);
+        }
+    }
+    queueCondition.notify_all();
+}
+
+void TraceWriter::Wait() {
+    std::unique_lock<std::mutex> lock(queueMutex);
+    queueCondition.wait(lock, [this] { return queuedFiles.empty() && !isWriting; });
+}
+
+void TraceWriter::WriterLoop() {
+    std::unique_lock<std::mutex> lock(queueMutex);
+    while (true) {
+        queueCondition.wait(lock, [this] { return !queuedFiles.empty() || isStopping; });
+        // Queued files are still written when stopping, so no capture is lost at shutdown
+        if (queuedFiles.empty()) {
+            return;
+        }
+        TraceFile traceFile = std::move(queuedFiles.front());
+        queuedFiles.pop_front();
+        isWriting = true;
+
+        lock.unlock();
+        WriteFile(traceFile.filePath, traceFile.events, traceFile.mainThreadIndex);
+        lock.lock();
+
+        isWriting = false;
+        queueCondition.notify_all();
+    }
+}
+
+// Scope names are meant to be literals, but a stray quote would still break the whole file
+static void WriteEscaped(std::FILE* file, const char* text) {
+    for (const char* c = text; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            std::fputc('\\', file);
+        }
+        if (static_cast<unsigned char>(*c) >= 0x20) {
+            std::fputc(*c, file);
+        }
+    }
+}
+
+void TraceWriter::WriteFile(const std::string& filePath, const std::vector<TraceEvent>& events, int mainThreadIndex) {
+    std::FILE* file = std::fopen(filePath.c_str(), "w");
+    if (!file) {
+        Logger::Err("Error opening the trace file " + filePath + ".");
+        return;
+    }
+
+    // Timestamps are in microseconds, relative to the first event
+    std::int64_t startTime = events.empty() ? 0 : events[0].time;
+    std::set<int> threadIndices;
+    for (const auto& event: events) {
+        startTime = std::min(startTime, event.time);
+        threadIndices.insert(event.threadIndex);
+    }
+
+    std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool isFirstEvent = true;
+    for (int threadIndex: threadIndices) {
+        std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"", isFirstEvent ? "" : ",\n", threadIndex);
+        if (threadIndex == mainThreadIndex) {
+            std::fprintf(file, "Main thread\"}}");
+        } else {
+            std::fprintf(file, "Thread %d\"}}", threadIndex);
+        }
+        isFirstEvent = false;
+    }
+    for (const auto& event: events) {
+        std::fprintf(file, "%s{\"name\":\"", isFirstEvent ? "" : ",\n");
+        WriteEscaped(file, event.name);
+        std::fprintf(file, "\",\"ph\":\"%c\",\"pid\":1,\"tid\":%d,\"ts\":%.3f", event.phase, event.threadIndex, (event.time - startTime) / 1000.0);
+        if (event.phase == 'X') {
+            std::fprintf(file, ",\"dur\":%.3f", event.duration / 1000.0);
+        }
+        std::fprintf(file, "}");
+        isFirstEvent = false;
+    }
+    std::fprintf(file, "\n]}\n");
+
+    if (std::fclose(file) != 0) {
+        Logger::Err("Error writing the trace file " + filePath + ".");
+        return;
+    }
+    Logger::Log("Trace of " + std::to_string(events.size()) + " events written to " + filePath + ".");
+}
@@ -0,0 +1,63 @@
+#ifndef TRACEWRITER_H
+#define TRACEWRITER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct TraceEvent {
+    const char* name;
+    // Nanoseconds on the steady clock
+    std::int64_t time;
+    // Only for complete events
+    std::int64_t duration;
+    int threadIndex;
+    // 'B' begin, 'E' end or 'X' complete, as in the trace event format
+    char phase;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// TraceWriter
+////////////////////////////////////////////////////////////////////////////////
+// Writes captured events as trace event JSON, the format read by
+// chrome://tracing and Perfetto. Formatting and writing the file happen on
+// a background thread, so the frames that follow a capture don't pay for it.
+// Captures handed over while a file is still being written wait in a queue.
+////////////////////////////////////////////////////////////////////////////////
+class TraceWriter {
+    private:
+        struct TraceFile {
+            std::string filePath;
+            std::vector<TraceEvent> events;
+            int mainThreadIndex;
+        };
+
+        std::thread writerThread;
+        std::mutex queueMutex;
+        std::condition_variable queueCondition;
+        std::deque<TraceFile> queuedFiles;
+        bool isWriting = false;
+        bool isStopping = false;
+
+        void WriterLoop();
+        static void WriteFile(const std::string& filePath, const std::vector<TraceEvent>& events, int mainThreadIndex);
+
+    public:
+        TraceWriter() = default;
+        ~TraceWriter();
+
+        TraceWriter(const TraceWriter&) = delete;
+        TraceWriter& operator =(const TraceWriter&) = delete;
+
+        // Takes the events over and queues them to be written in the background, never blocks on a write
+        void Write(const std::string& filePath, std::vector<TraceEvent>&& events, int mainThreadIndex);
+
+        // Blocks until every queued write is done
+        void Wait();
+};
+
+#endif
@@ -0,0 +1,275 @@
+#ifndef HIERARCHYSYSTEM_H
+#define HIERARCHYSYSTEM_H
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include "../ECS/ECS.h"
+#include "../Components/TransformComponent.h"
+#include "../Components/HierarchyComponent.h"
+#include "../Jobs/JobSystem.h"
+#include "../Logger/Logger.h"
+
+// Deeper chains of parents are assumed to be a cycle
+const int MAX_HIERARCHY_DEPTH = 64;
+
+////////////////////////////////////////////////////////////////////////////////
+// HierarchySystem
+////////////////////////////////////////////////////////////////////////////////
+// Computes the world transform of every entity attached to a parent. Only
+// the subtrees that changed since the last run are visited: a child becomes
+// dirty when its local transform changes or when its parent's transform
+// changes, and the dirty flag flows down to its own children. Dirty entities
+// are bucketed by depth and each depth is processed as one batch, so parents
+// are always up to date before their children read them. Static hierarchies
+// cost nothing beyond the change version checks.
+// The tree only depends on the hierarchy components, so it is rebuilt when
+// entities are attached, detached or re-parented, never because other
+// entities come and go. Whether a parent is alive and has a transform is
+// checked when its children are updated: a child whose parent is gone keeps
+// its last world transform.
+////////////////////////////////////////////////////////////////////////////////
+class HierarchySystem: public System {
+    private:
+        // Depth of entities that are not attached to anything, and of children stuck in a cycle
+        static constexpr int DEPTH_ROOT = 0;
+        static constexpr int DEPTH_DETACHED = -1;
+        static constexpr int DEPTH_UNKNOWN = -2;
+
+        JobSystem* jobSystem;
+
+        // Version of the registry at the start of the last run
+        unsigned int lastRunVersion = 0;
+
+        // Layout revision of the hierarchy components the tree below was built from
+        unsigned int hierarchyRevision = 0;
+        bool isTreeBuilt = false;
+
+        // Attached entities that gained or lost their transform since the last run
+        std::vector<Entity> entitiesWithChangedTransform;
+
+        // Attached entities whose hierarchy component changed since the last run
+        std::vector<Entity> changedEntities;
+
+        // The tree, rebuilt only when entities are attached, detached or re-parented
+        std::unordered_map<int, std::vector<Entity>> childrenPerEntity;
+        std::vector<Entity> parentPerEntity;
+        std::vector<int> depthPerEntity;
+
+        // Dirty entities waiting to be updated, one batch per depth
+        std::vector<std::vector<Entity>> dirtyEntitiesPerDepth;
+        std::vector<bool> isEntityDirty;
+
+        bool IsTreeOutdated() const {
+            if (!isTreeBuilt) {
+                return true;
+            }
+            // Attaching, detaching or killing an attached entity changes the layout of the hierarchy components
+            return registry->GetLayoutRevision<HierarchyComponent>() != hierarchyRevision;
+        }
+
+        void BuildTree() {
+            childrenPerEntity.clear();
+            int numIds = 0;
+            registry->View<HierarchyComponent>().Each([&](Entity entity, HierarchyComponent& hierarchy) {
+                numIds = std::max(numIds, entity.GetId() + 1);
+                // A dead parent may be the invalid entity, whose index is past every real one
+                if (registry->IsAlive(hierarchy.parent)) {
+                    numIds = std::max(numIds, hierarchy.parent.GetId() + 1);
+                }
+            });
+            parentPerEntity.assign(numIds, Entity(0));
+            depthPerEntity.assign(numIds, DEPTH_ROOT);
+            isEntityDirty.assign(numIds, false);
+            for (auto& dirtyEntities: dirtyEntitiesPerDepth) {
+                dirtyEntities.clear();
+            }
+
+            registry->View<HierarchyComponent>().Each([&](Entity entity, HierarchyComponent& hierarchy) {
+                parentPerEntity[entity.GetId()] = hierarchy.parent;
+                depthPerEntity[entity.GetId()] = DEPTH_UNKNOWN;
+                if (registry->IsAlive(hierarchy.parent)) {
+                    childrenPerEntity[hierarchy.parent.GetId()].push_back(entity);
+                }
+            });
+
+            int maxDepth = 0;
+            for (int entityId = 0; entityId < numIds; entityId++) {
+                if (depthPerEntity[entityId] == DEPTH_UNKNOWN) {
+                    ComputeDepth(entityId);
+                }
+                maxDepth = std::max(maxDepth, depthPerEntity[entityId]);
+            }
+            dirtyEntitiesPerDepth.resize(maxDepth + 1);
+
+            // Nothing is marked dirty here: newly attached entities have a changed hierarchy
+            // component, and the entities that stay attached keep their world transforms
+            hierarchyRevision = registry->GetLayoutRevision<HierarchyComponent>();
+            isTreeBuilt = true;
+        }
+
+        void ComputeDepth(int entityId) {
+            // Walk up until an ancestor of known depth (roots are known), then assign the depths back down
+            std::vector<int> chain;
+            int depth = DEPTH_DETACHED;
+            int currentId = entityId;
+            while (true) {
+                if (depthPerEntity[currentId] != DEPTH_UNKNOWN) {
+                    depth = depthPerEntity[currentId];
+                    break;
+                }
+                chain.push_back(currentId);
+                if (static_cast<int>(chain.size()) > MAX_HIERARCHY_DEPTH) {
+                    Logger::Err("Entity hierarchy is too deep or has a cycle, detaching entity " + std::to_string(entityId));
+                    depth = DEPTH_DETACHED;
+                    break;
+                }
+                // A dead parent counts as a root, its index may already belong to another entity
+                Entity parent = parentPerEntity[currentId];
+                if (!registry->IsAlive(parent)) {
+                    depth = DEPTH_ROOT;
+                    break;
+                }
+                currentId = parent.GetId();
+            }
+            for (int i = static_cast<int>(chain.size()) - 1; i >= 0; i--) {
+                depth = depth == DEPTH_DETACHED ? DEPTH_DETACHED : depth + 1;
+                depthPerEntity[chain[i]] = depth;
+            }
+        }
+
+        void MarkDirty(Entity entity) {
+            const auto entityId = entity.GetId();
+            if (entityId >= static_cast<int>(depthPerEntity.size()) || isEntityDirty[entityId]) {
+                return;
+            }
+            int depth = depthPerEntity[entityId];
+            if (depth < 1) {
+                return;
+            }
+            isEntityDirty[entityId] = true;
+            dirtyEntitiesPerDepth[depth].push_back(entity);
+        }
+
+        void MarkChildrenDirty(Entity entity) {
+            auto children = childrenPerEntity.find(entity.GetId());
+            if (children == childrenPerEntity.end()) {
+                return;
+            }
+            for (auto child: children->second) {
+                MarkDirty(child);
+            }
+        }
+
+        void UpdateWorldTransform(Entity entity) {
+            const HierarchyComponent& hierarchy = registry->GetComponent<HierarchyComponent>(entity);
+            // Without a parent transform the entity is detached and keeps its last world transform
+            if (!registry->HasComponent<TransformComponent>(hierarchy.parent) || !registry->HasComponent<TransformComponent>(entity)) {
+                return;
+            }
+            TransformComponent parentTransform = registry->GetComponent<TransformComponent>(hierarchy.parent);
+
+            // World = parent translation * parent rotation * parent scale * local transform
+            float angle = glm::radians(parentTransform.rotation);
+            float cosine = std::cos(angle);
+            float sine = std::sin(angle);
+            glm::vec2 scaledPosition = hierarchy.localPosition * parentTransform.scale;
+            glm::vec2 rotatedPosition(
+                scaledPosition.x * cosine - scaledPosition.y * sine,
+                scaledPosition.x * sine + scaledPosition.y * cosine
+            );
+
+            ComponentRef<TransformComponent> transform = registry->GetComponent<TransformComponent>(entity);
+            transform = TransformComponent(
+                parentTransform.position + rotatedPosition,
+                parentTransform.scale * hierarchy.localScale,
+                parentTransform.rotation + hierarchy.localRotation
+            );
+            registry->MarkChanged<TransformComponent>(entity);
+        }
+
+    public:
+        HierarchySystem(JobSystem* jobSystem = nullptr): jobSystem(jobSystem) {
+            RequireComponent<HierarchyComponent>();
+            RequireComponent<TransformComponent>();
+            ReadsComponent<HierarchyComponent>();
+            WritesComponent<TransformComponent>();
+        }
+
+        const char* GetName() const override { return "HierarchySystem"; }
+
+        // Gaining or losing a transform does not change the tree, only the subtree to recompute
+        void OnEntityAdded(Entity entity) override {
+            entitiesWithChangedTransform.push_back(entity);
+        }
+
+        void OnEntityRemoved(Entity entity) override {
+            entitiesWithChangedTransform.push_back(entity);
+        }
+
+        void Update(double) override {
+            if (!registry->GetPool<HierarchyComponent>()) {
+                return;
+            }
+            unsigned int since = lastRunVersion;
+            lastRunVersion = registry->GetChangeVersion();
+
+            // Re-parenting keeps the layout of the hierarchy components, so compare the parents too
+            bool isTreeOutdated = IsTreeOutdated();
+            changedEntities.clear();
+            registry->EachChangedSince<HierarchyComponent>(since, [&](Entity entity, HierarchyComponent& hierarchy) {
+                const auto entityId = entity.GetId();
+                if (entityId >= static_cast<int>(parentPerEntity.size()) || hierarchy.parent != parentPerEntity[entityId]) {
+                    isTreeOutdated = true;
+                }
+                changedEntities.push_back(entity);
+            });
+            if (isTreeOutdated) {
+                BuildTree();
+            }
+
+            for (auto entity: changedEntities) {
+                MarkDirty(entity);
+            }
+            for (auto entity: entitiesWithChangedTransform) {
+                if (registry->IsAlive(entity)) {
+                    MarkDirty(entity);
+                    MarkChildrenDirty(entity);
+                }
+            }
+            entitiesWithChangedTransform.clear();
+
+            // A moved root dirties its children. The transforms of attached entities are our
+            // own output, so their changes are picked up below while walking down the tree.
+            registry->EachChangedSince<TransformComponent>(since, [this](Entity entity, ComponentRef<TransformComponent>) {
+                if (!entity.HasComponent<HierarchyComponent>()) {
+                    MarkChildrenDirty(entity);
+                }
+            });
+
+            // Parents before children: each depth only reads the transforms of the one above
+            for (int depth = 1; depth < static_cast<int>(dirtyEntitiesPerDepth.size()); depth++) {
+                std::vector<Entity>& dirtyEntities = dirtyEntitiesPerDepth[depth];
+                auto updateBatch = [this, &dirtyEntities](int begin, int end) {
+                    for (int i = begin; i < end; i++) {
+                        UpdateWorldTransform(dirtyEntities[i]);
+                    }
+                };
+                if (jobSystem) {
+                    jobSystem->ParallelFor(static_cast<int>(dirtyEntities.size()), 1, updateBatch);
+                } else {
+                    updateBatch(0, static_cast<int>(dirtyEntities.size()));
+                }
+                for (auto entity: dirtyEntities) {
+                    isEntityDirty[entity.GetId()] = false;
+                    MarkChildrenDirty(entity);
+                }
+                dirtyEntities.clear();
+            }
+        }
+};
+
+#endif
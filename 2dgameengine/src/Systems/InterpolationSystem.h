@@ -0,0 +1,31 @@
+#ifndef INTERPOLATIONSYSTEM_H
+#define INTERPOLATIONSYSTEM_H
+
+#include "../ECS/ECS.h"
+#include "../Components/TransformComponent.h"
+#include "../Components/InterpolationComponent.h"
+
+// Remembers the transform of the entities before a simulation step moves them.
+// Must be scheduled before the systems that write transforms.
+class InterpolationSystem: public System {
+    public:
+        InterpolationSystem() {
+            RequireComponent<TransformComponent>();
+            RequireComponent<InterpolationComponent>();
+            ReadsComponent<TransformComponent>();
+            WritesComponent<InterpolationComponent>();
+        }
+
+        const char* GetName() const override { return "InterpolationSystem"; }
+
+        void Update(double) override {
+            registry->View<TransformComponent, InterpolationComponent>().Each(
+                [](ComponentRef<TransformComponent> transform, InterpolationComponent& interpolation) {
+                    interpolation.previousPosition = transform.position;
+                    interpolation.previousRotation = transform.rotation;
+                }
+            );
+        }
+};
+
+#endif
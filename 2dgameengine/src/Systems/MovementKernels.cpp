@@ -0,0 +1,116 @@
+#include "MovementKernels.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MOVEMENT_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+// The vector kernels read the velocities as a flat array of (x, y) floats
+static_assert(sizeof(RigidBodyComponent) == 2 * sizeof(float), "RigidBodyComponent must only hold its velocity");
+
+typedef void (*IntegratePositionsFunction)(float*, float*, const RigidBodyComponent*, int, float, unsigned int*, unsigned int);
+
+void MovementKernels::IntegratePositionsScalar(float* positionX, float* positionY, const RigidBodyComponent* rigidBodies, int count, float deltaTime, unsigned int* versions, unsigned int version) {
+    for (int i = 0; i < count; i++) {
+        const glm::vec2 velocity = rigidBodies[i].velocity;
+        positionX[i] += velocity.x * deltaTime;
+        positionY[i] += velocity.y * deltaTime;
+        // Only the entities that actually moved count as changed
+        if (velocity.x != 0.0f || velocity.y != 0.0f) {
+            versions[i] = version;
+        }
+    }
+}
+
+#ifdef MOVEMENT_KERNELS_X86
+
+__attribute__((target("sse2")))
+static void IntegratePositionsSSE2(float* positionX, float* positionY, const RigidBodyComponent* rigidBodies, int count, float deltaTime, unsigned int* versions, unsigned int version) {
+    const float* velocity = reinterpret_cast<const float*>(rigidBodies);
+    const __m128 dt = _mm_set1_ps(deltaTime);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128i newVersion = _mm_set1_epi32(static_cast<int>(version));
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        // Split 4 interleaved (x, y) velocities into an x vector and a y vector
+        __m128 v01 = _mm_loadu_ps(velocity + 2 * i);
+        __m128 v23 = _mm_loadu_ps(velocity + 2 * i + 4);
+        __m128 vx = _mm_shuffle_ps(v01, v23, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 vy = _mm_shuffle_ps(v01, v23, _MM_SHUFFLE(3, 1, 3, 1));
+
+        __m128 px = _mm_loadu_ps(positionX + i);
+        __m128 py = _mm_loadu_ps(positionY + i);
+        _mm_storeu_ps(positionX + i, _mm_add_ps(px, _mm_mul_ps(vx, dt)));
+        _mm_storeu_ps(positionY + i, _mm_add_ps(py, _mm_mul_ps(vy, dt)));
+
+        // Blend the new version into the lanes that moved, and skip the store when none did
+        __m128 moved = _mm_or_ps(_mm_cmpneq_ps(vx, zero), _mm_cmpneq_ps(vy, zero));
+        if (_mm_movemask_ps(moved) != 0) {
+            __m128i movedMask = _mm_castps_si128(moved);
+            __m128i* versionsOut = reinterpret_cast<__m128i*>(versions + i);
+            __m128i oldVersions = _mm_loadu_si128(versionsOut);
+            _mm_storeu_si128(versionsOut, _mm_or_si128(_mm_and_si128(movedMask, newVersion), _mm_andnot_si128(movedMask, oldVersions)));
+        }
+    }
+    MovementKernels::IntegratePositionsScalar(positionX + i, positionY + i, rigidBodies + i, count - i, deltaTime, versions + i, version);
+}
+
+__attribute__((target("avx2")))
+static void IntegratePositionsAVX2(float* positionX, float* positionY, const RigidBodyComponent* rigidBodies, int count, float deltaTime, unsigned int* versions, unsigned int version) {
+    const float* velocity = reinterpret_cast<const float*>(rigidBodies);
+    const __m256 dt = _mm256_set1_ps(deltaTime);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256i newVersion = _mm256_set1_epi32(static_cast<int>(version));
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        // The in-lane shuffle leaves the pairs as (0 1 4 5 2 3 6 7), the cross-lane permute restores the order
+        __m256 v0123 = _mm256_loadu_ps(velocity + 2 * i);
+        __m256 v4567 = _mm256_loadu_ps(velocity + 2 * i + 8);
+        __m256 vx = _mm256_shuffle_ps(v0123, v4567, _MM_SHUFFLE(2, 0, 2, 0));
+        __m256 vy = _mm256_shuffle_ps(v0123, v4567, _MM_SHUFFLE(3, 1, 3, 1));
+        vx = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(vx), _MM_SHUFFLE(3, 1, 2, 0)));
+        vy = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(vy), _MM_SHUFFLE(3, 1, 2, 0)));
+
+        __m256 px = _mm256_loadu_ps(positionX + i);
+        __m256 py = _mm256_loadu_ps(positionY + i);
+        _mm256_storeu_ps(positionX + i, _mm256_add_ps(px, _mm256_mul_ps(vx, dt)));
+        _mm256_storeu_ps(positionY + i, _mm256_add_ps(py, _mm256_mul_ps(vy, dt)));
+
+        // Store the new version only into the lanes that moved, and skip the store when none did
+        __m256 moved = _mm256_or_ps(_mm256_cmp_ps(vx, zero, _CMP_NEQ_UQ), _mm256_cmp_ps(vy, zero, _CMP_NEQ_UQ));
+        if (_mm256_movemask_ps(moved) != 0) {
+            _mm256_maskstore_epi32(reinterpret_cast<int*>(versions + i), _mm256_castps_si256(moved), newVersion);
+        }
+    }
+    IntegratePositionsSSE2(positionX + i, positionY + i, rigidBodies + i, count - i, deltaTime, versions + i, version);
+}
+
+#endif
+
+struct MovementKernel {
+    IntegratePositionsFunction integratePositions;
+    const char* name;
+};
+
+static MovementKernel SelectMovementKernel() {
+#ifdef MOVEMENT_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return {IntegratePositionsAVX2, "AVX2"};
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return {IntegratePositionsSSE2, "SSE2"};
+    }
+#endif
+    return {MovementKernels::IntegratePositionsScalar, "scalar"};
+}
+
+static const MovementKernel movementKernel = SelectMovementKernel();
+
+void MovementKernels::IntegratePositions(float* positionX, float* positionY, const RigidBodyComponent* rigidBodies, int count, float deltaTime, unsigned int* versions, unsigned int version) {
+    movementKernel.integratePositions(positionX, positionY, rigidBodies, count, deltaTime, versions, version);
+}
+
+const char* MovementKernels::GetKernelName() {
+    return movementKernel.name;
+}
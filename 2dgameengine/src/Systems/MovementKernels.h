@@ -0,0 +1,28 @@
+#ifndef MOVEMENTKERNELS_H
+#define MOVEMENTKERNELS_H
+
+#include "../Components/RigidBodyComponent.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// MovementKernels
+////////////////////////////////////////////////////////////////////////////////
+// Batch kernels used by the MovementSystem. The best implementation for the
+// CPU the game runs on (AVX2, SSE2 or plain scalar code) is picked once at
+// startup through CPU feature detection.
+////////////////////////////////////////////////////////////////////////////////
+class MovementKernels {
+    public:
+        // position += velocity * deltaTime for "count" entities. Positions are two separate
+        // streams (x and y), rigid bodies are an array in the same entity order.
+        // The change version of every entity with a nonzero velocity is set to "version"
+        // in the same pass, the others keep theirs.
+        static void IntegratePositions(float* positionX, float* positionY, const RigidBodyComponent* rigidBodies, int count, float deltaTime, unsigned int* versions, unsigned int version);
+
+        // The scalar version, always available
+        static void IntegratePositionsScalar(float* positionX, float* positionY, const RigidBodyComponent* rigidBodies, int count, float deltaTime, unsigned int* versions, unsigned int version);
+
+        // Name of the implementation selected for this CPU
+        static const char* GetKernelName();
+};
+
+#endif
@@ -1,22 +1,73 @@
 #ifndef MOVEMENTSYSTEM_H
 #define MOVEMENTSYSTEM_H
 
-#include "ECS/ECS.h"
+#include "../ECS/ECS.h"
+#include "../Components/TransformComponent.h"
+#include "../Components/RigidBodyComponent.h"
+#include "../Jobs/JobSystem.h"
+#include "MovementKernels.h"
 
 class MovementSystem: public System {
+    private:
+        // Splits the bulk update across the cores, runs on the calling thread if null
+        JobSystem* jobSystem;
+
     public:
-        MovementSystem() {
-            // TODO:
-            // RequireComponent<TransformComponent>();
-            // RequireComponent<...>();
+        MovementSystem(JobSystem* jobSystem = nullptr): jobSystem(jobSystem) {
+            RequireComponent<TransformComponent>();
+            RequireComponent<RigidBodyComponent>();
+            WritesComponent<TransformComponent>();
+            // Lining up the pools reorders the rigid bodies too
+            WritesComponent<RigidBodyComponent>();
         }
 
-        void Update() {
-            // TODO:
-            // Loop all entities that the system is interested in
-            // for (auto entity: GetEntities()) {
-                // TODO: Update entity position based on its velocity
-            // }
+        const char* GetName() const override { return "MovementSystem"; }
+
+        void Update(double deltaTime) override {
+            // With transforms stored as streams, line up the transform and rigid body pools
+            // so the moving entities sit in the same slots of both, and integrate them in bulk
+#ifndef TRANSFORM_LAYOUT_AOS
+            if (registry->GetStorageMode() == STORAGE_POOLS) {
+                int count = registry->AlignPools<TransformComponent, RigidBodyComponent>();
+                if (count == 0) {
+                    return;
+                }
+                float* positionX = registry->GetPool<TransformComponent>()->GetData().GetPositionX();
+                float* positionY = registry->GetPool<TransformComponent>()->GetData().GetPositionY();
+                unsigned int* transformVersions = registry->GetPool<TransformComponent>()->GetVersions();
+                RigidBodyComponent* rigidBodies = registry->GetPool<RigidBodyComponent>()->GetData().GetData();
+                unsigned int version = registry->GetChangeVersion();
+                auto integrate = [=](int begin, int end) {
+                    MovementKernels::IntegratePositions(
+                        positionX + begin,
+                        positionY + begin,
+                        rigidBodies + begin,
+                        end - begin,
+                        static_cast<float>(deltaTime),
+                        transformVersions + begin,
+                        version
+                    );
+                };
+                if (jobSystem) {
+                    // Batches cover whole cache lines of the position streams
+                    jobSystem->ParallelFor(count, CACHE_LINE_SIZE / sizeof(float), integrate);
+                } else {
+                    integrate(0, count);
+                }
+                return;
+            }
+#endif
+
+            // Otherwise update entity position based on its velocity, one entity at a time
+            registry->View<TransformComponent, RigidBodyComponent>().Each(
+                [this, deltaTime](Entity entity, ComponentRef<TransformComponent> transform, RigidBodyComponent& rigidBody) {
+                    transform.position.x += rigidBody.velocity.x * deltaTime;
+                    transform.position.y += rigidBody.velocity.y * deltaTime;
+                    if (rigidBody.velocity != glm::vec2(0.0f)) {
+                        registry->MarkChanged<TransformComponent>(entity);
+                    }
+                }
+            );
         }
 };
 
@@ -0,0 +1,56 @@
+#ifndef RENDERSYSTEM_H
+#define RENDERSYSTEM_H
+
+#include <SDL2/SDL.h>
+#include <glm/glm.hpp>
+#include "../ECS/ECS.h"
+#include "../Components/TransformComponent.h"
+#include "../Components/SpriteComponent.h"
+#include "../Components/InterpolationComponent.h"
+
+class RenderSystem: public System {
+    private:
+        int numDrawCalls = 0;
+
+    public:
+        RenderSystem() {
+            RequireComponent<TransformComponent>();
+            RequireComponent<SpriteComponent>();
+        }
+
+        const char* GetName() const override { return "RenderSystem"; }
+
+        // Not part of the simulation, the game calls the overload below once per rendered frame
+        using System::Update;
+
+        // Draws the entities "alpha" of the way between their previous and current simulation state
+        void Update(SDL_Renderer* renderer, double alpha) {
+            numDrawCalls = 0;
+            registry->View<TransformComponent, SpriteComponent>().Each(
+                [this, renderer, alpha](Entity entity, ComponentRef<TransformComponent> transform, SpriteComponent& sprite) {
+                    glm::vec2 position = transform.position;
+                    if (registry->HasComponent<InterpolationComponent>(entity)) {
+                        const InterpolationComponent& interpolation = registry->GetComponent<InterpolationComponent>(entity);
+                        position = glm::mix(interpolation.previousPosition, position, static_cast<float>(alpha));
+                    }
+
+                    SDL_Rect objRect = {
+                        static_cast<int>(position.x),
+                        static_cast<int>(position.y),
+                        static_cast<int>(sprite.width * transform.scale.x),
+                        static_cast<int>(sprite.height * transform.scale.y)
+                    };
+                    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+                    SDL_RenderFillRect(renderer, &objRect);
+                    numDrawCalls++;
+                }
+            );
+        }
+
+        // Draw calls submitted by the last Update()
+        int GetNumDrawCalls() const {
+            return numDrawCalls;
+        }
+};
+
+#endif